@@ -0,0 +1,212 @@
+// Lock profiler shared by the OpenMP engines (flowerSM-1, flowerSM-2) and the
+// hybrid MPI+OpenMP engine (flower-Hybrid-1), so their --profile-locks tables
+// and heatmaps measure the same thing.
+#pragma once
+
+#include <omp.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Lock contention profiling (--profile-locks). Every lock the market takes is
+// wrapped; once a LockProfile is attached the wrapper counts acquires and
+// contended acquires, sorts each wait into a decade histogram and sums wait
+// and hold time. Without a profile a wrapper is the plain lock behind one null
+// check, so the default build pays nothing measurable.
+struct LockProfile
+{
+    static const int Buckets = 7; // Waits under 100ns, 1us, 10us, 100us, 1ms, 10ms, and longer
+
+    std::atomic<long long> acquires{0};
+    std::atomic<long long> contended{0}; // Acquires that found the lock taken
+    std::atomic<long long> retries{0};   // Failed lock-free attempts on the state the lock guards
+    std::atomic<long long> wait_ns{0};
+    std::atomic<long long> hold_ns{0};
+    std::atomic<long long> max_wait_ns{0};
+    std::atomic<long long> histogram[Buckets] = {};
+
+    static long long now()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    }
+
+    void acquired(long long waited, bool was_contended)
+    {
+        acquires.fetch_add(1, std::memory_order_relaxed);
+        if (was_contended)
+            contended.fetch_add(1, std::memory_order_relaxed);
+        wait_ns.fetch_add(waited, std::memory_order_relaxed);
+        int bucket = 0;
+        for (long long limit = 100; bucket < Buckets - 1 && waited >= limit; limit *= 10)
+            ++bucket;
+        histogram[bucket].fetch_add(1, std::memory_order_relaxed);
+        long long longest = max_wait_ns.load(std::memory_order_relaxed);
+        while (waited > longest && !max_wait_ns.compare_exchange_weak(longest, waited, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    void released(long long held)
+    {
+        hold_ns.fetch_add(held, std::memory_order_relaxed);
+    }
+
+    // Fold another profile into this one, e.g. to total every seller lock
+    void add(const LockProfile &other)
+    {
+        acquires += other.acquires.load();
+        contended += other.contended.load();
+        retries += other.retries.load();
+        wait_ns += other.wait_ns.load();
+        hold_ns += other.hold_ns.load();
+        max_wait_ns.store(std::max(max_wait_ns.load(), other.max_wait_ns.load()));
+        for (int b = 0; b < Buckets; ++b)
+            histogram[b] += other.histogram[b].load();
+    }
+
+    // Heatmap intensity, the same in every engine: time spent waiting for the
+    // lock, with each failed lock-free attempt counted as a 100ns wait
+    double heat() const
+    {
+        return wait_ns.load() + 100.0 * retries.load();
+    }
+
+    static void printHeader()
+    {
+        std::cout << "   " << std::left << std::setw(20) << "Lock" << std::right << std::setw(10) << "Acquires"
+                  << std::setw(11) << "Contended" << std::setw(10) << "Retries" << std::setw(12) << "Wait ns"
+                  << std::setw(12) << "Hold ns" << std::setw(12) << "Max wait" << "  Wait histogram (<100ns..>=10ms)\n";
+    }
+
+    // Wait and hold are per acquire, max wait in ns
+    void print(const std::string &name) const
+    {
+        long long n = acquires.load();
+        std::cout << "   " << std::left << std::setw(20) << name << std::right << std::setw(10) << n
+                  << std::setw(10) << std::fixed << std::setprecision(1) << (n ? 100.0 * contended.load() / n : 0.0)
+                  << "%" << std::setw(10) << retries.load() << std::setw(12) << (n ? wait_ns.load() / n : 0)
+                  << std::setw(12) << (n ? hold_ns.load() / n : 0) << std::setw(12) << max_wait_ns.load() << "  ";
+        for (int b = 0; b < Buckets; ++b)
+            std::cout << (b ? "/" : "") << histogram[b].load();
+        std::cout << "\n";
+    }
+};
+
+// One shade per lock, 64 to a row; darker means more time lost on it, on a
+// log scale relative to the hottest lock
+inline void printLockHeatmap(const std::vector<LockProfile> &profiles)
+{
+    static const char Shades[] = " .:-=+*#%@";
+    const size_t Row = 64;
+    double hottest = 0;
+    for (const LockProfile &profile : profiles)
+        hottest = std::max(hottest, std::log1p(profile.heat()));
+    for (size_t i = 0; i < profiles.size(); i += Row)
+    {
+        std::cout << "   " << std::setw(6) << i << " |";
+        for (size_t j = i; j < std::min(i + Row, profiles.size()); ++j)
+            std::cout << Shades[hottest > 0 ? (int)std::lround(std::log1p(profiles[j].heat()) / hottest * 9) : 0];
+        std::cout << "|\n";
+    }
+}
+
+// std::mutex that reports to an attached LockProfile; works with std::lock_guard.
+// lock(site) also charges the acquire and hold to `site`, so time under the
+// one trade mutex can be split by seller. Attach before the mutex is shared.
+class ProfiledMutex
+{
+public:
+    void profile(LockProfile *target) { attached = target; }
+
+    void lock(LockProfile *site = nullptr)
+    {
+        if (!attached)
+        {
+            mutex.lock();
+            return;
+        }
+        bool contended = !mutex.try_lock();
+        long long start = contended ? LockProfile::now() : 0;
+        if (contended)
+            mutex.lock();
+        held_since = LockProfile::now();
+        held_by = attached;
+        held_for = site;
+        long long waited = contended ? held_since - start : 0;
+        held_by->acquired(waited, contended);
+        if (held_for)
+            held_for->acquired(waited, contended);
+    }
+
+    void unlock()
+    {
+        if (held_by)
+        {
+            long long held = LockProfile::now() - held_since;
+            held_by->released(held);
+            if (held_for)
+                held_for->released(held);
+            held_by = held_for = nullptr;
+        }
+        mutex.unlock();
+    }
+
+private:
+    std::mutex mutex;
+    LockProfile *attached = nullptr;
+    LockProfile *held_by = nullptr;  // Profile the current hold is timed against
+    LockProfile *held_for = nullptr; // And the site it was taken for, if any
+    long long held_since = 0;
+};
+
+// omp_lock_t counterpart of ProfiledMutex, used for the per-agent locks
+class ProfiledOmpLock
+{
+public:
+    ProfiledOmpLock() { omp_init_lock(&lock); }
+    ~ProfiledOmpLock() { omp_destroy_lock(&lock); }
+    ProfiledOmpLock(const ProfiledOmpLock &) = delete;
+    ProfiledOmpLock &operator=(const ProfiledOmpLock &) = delete;
+
+    void profile(LockProfile *target) { attached = target; }
+
+    void set()
+    {
+        if (!attached)
+        {
+            omp_set_lock(&lock);
+            return;
+        }
+        bool contended = !omp_test_lock(&lock);
+        long long start = contended ? LockProfile::now() : 0;
+        if (contended)
+            omp_set_lock(&lock);
+        held_since = LockProfile::now();
+        held_by = attached;
+        held_by->acquired(contended ? held_since - start : 0, contended);
+    }
+
+    void unset()
+    {
+        if (held_by)
+        {
+            held_by->released(LockProfile::now() - held_since);
+            held_by = nullptr;
+        }
+        omp_unset_lock(&lock);
+    }
+
+private:
+    omp_lock_t lock;
+    LockProfile *attached = nullptr;
+    LockProfile *held_by = nullptr;
+    long long held_since = 0;
+};
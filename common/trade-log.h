@@ -0,0 +1,242 @@
+// Per-thread record rings and the asynchronous logger built on them, shared by
+// the OpenMP engine (flowerSM-2) and the hybrid MPI+OpenMP engine
+// (flower-Hybrid-1), so both log fills the same way.
+#pragma once
+
+#include <omp.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+// Per-thread record rings drained by one background thread. The producer id is
+// the OpenMP thread number and there is one single-producer ring per id, sized
+// from omp_get_max_threads() when the rings start, so a push is a struct copy
+// and one release store: no lock, no allocation after the first push. A thread
+// whose id has no ring (a team larger than the one the rings were sized for,
+// or a nested team whose ids repeat the outer team's) is refused a ring and
+// goes through the locked overflow list instead, so no ring ever has two
+// producers. The drain thread hands batches to the sink in per-ring order.
+template <typename Record>
+class ThreadRings
+{
+public:
+    typedef std::function<void(const Record *, size_t)> Sink;
+
+    ~ThreadRings()
+    {
+        stop();
+        releaseRings();
+    }
+
+    void start(Sink batch_sink, int producers = omp_get_max_threads())
+    {
+        stop();
+        releaseRings();
+        sink = batch_sink;
+        ring_count = std::max(1, producers);
+        rings.reset(new std::atomic<Ring *>[ring_count]);
+        for (int r = 0; r < ring_count; ++r)
+            rings[r].store(nullptr, std::memory_order_relaxed);
+        running.store(true, std::memory_order_release);
+        drainer = std::thread([this]()
+                              {
+                                  while (running.load(std::memory_order_acquire))
+                                  {
+                                      if (drain() == 0)
+                                          std::this_thread::sleep_for(std::chrono::microseconds(200));
+                                  }
+                                  drain(); });
+    }
+
+    // Drain whatever is left and stop; records pushed afterwards are ignored
+    void stop()
+    {
+        if (!running.exchange(false))
+            return;
+        drainer.join();
+    }
+
+    bool active() const { return running.load(std::memory_order_relaxed); }
+
+    void push(const Record &entry)
+    {
+        if (!active())
+            return;
+
+        Ring *ring = ringFor(omp_get_thread_num());
+        if (!ring)
+        {
+            std::lock_guard<std::mutex> lock(overflow_mutex);
+            overflow.push_back(entry);
+            refused.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        unsigned long long head = ring->head.load(std::memory_order_relaxed);
+        while (head - ring->tail.load(std::memory_order_acquire) >= RingSize)
+            std::this_thread::yield(); // Full: wait for the drain rather than lose a record
+        ring->slot[head & (RingSize - 1)] = entry;
+        ring->head.store(head + 1, std::memory_order_release);
+    }
+
+    // Wait until everything pushed so far has been through the sink
+    void flush()
+    {
+        for (int r = 0; r < ring_count; ++r)
+        {
+            Ring *ring = rings[r].load(std::memory_order_acquire);
+            if (!ring)
+                continue;
+            unsigned long long head = ring->head.load(std::memory_order_acquire);
+            while (active() && ring->tail.load(std::memory_order_acquire) < head)
+                std::this_thread::yield();
+        }
+    }
+
+    long long drained() const { return drained_count.load(); }
+    long long refusedPushes() const { return refused.load(); } // Pushes that had no ring
+
+private:
+    static const int RingSize = 4096; // Records per thread, a power of two
+    static const size_t Line = 64;    // Cache line
+
+    struct Ring
+    {
+        alignas(Line) std::atomic<unsigned long long> head{0}; // Next slot the producer fills
+        alignas(Line) std::atomic<unsigned long long> tail{0}; // Next slot the drain reads
+        Record slot[RingSize];
+    };
+
+    std::unique_ptr<std::atomic<Ring *>[]> rings;
+    int ring_count = 0;
+    std::mutex overflow_mutex;
+    std::vector<Record> overflow;
+    std::atomic<long long> refused{0};
+
+    std::atomic<bool> running{false};
+    std::thread drainer;
+    Sink sink;
+    std::atomic<long long> drained_count{0};
+
+    void releaseRings()
+    {
+        for (int r = 0; r < ring_count; ++r)
+            delete rings[r].load(std::memory_order_relaxed);
+        rings.reset();
+        ring_count = 0;
+    }
+
+    // The ring of producer `id`, allocated by its first push so its pages are
+    // first touched by the producer; nullptr when the id has no ring
+    Ring *ringFor(int id)
+    {
+        if (id < 0 || id >= ring_count || omp_get_level() > 1)
+            return nullptr;
+        Ring *ring = rings[id].load(std::memory_order_acquire);
+        if (!ring)
+        {
+            ring = new Ring();
+            rings[id].store(ring, std::memory_order_release);
+        }
+        return ring;
+    }
+
+    // Drain side: pass every ring's published records to the sink; returns how many
+    size_t drain()
+    {
+        size_t total = 0;
+        for (int r = 0; r < ring_count; ++r)
+        {
+            Ring *ring = rings[r].load(std::memory_order_acquire);
+            if (!ring)
+                continue;
+            unsigned long long tail = ring->tail.load(std::memory_order_relaxed);
+            unsigned long long head = ring->head.load(std::memory_order_acquire);
+            while (tail < head)
+            {
+                size_t at = tail & (RingSize - 1);
+                size_t chunk = std::min<unsigned long long>(head - tail, RingSize - at);
+                sink(ring->slot + at, chunk);
+                tail += chunk;
+                total += chunk;
+            }
+            ring->tail.store(tail, std::memory_order_release);
+        }
+
+        std::vector<Record> spilled;
+        {
+            std::lock_guard<std::mutex> lock(overflow_mutex);
+            spilled.swap(overflow);
+        }
+        if (!spilled.empty())
+        {
+            sink(spilled.data(), spilled.size());
+            total += spilled.size();
+        }
+        drained_count.fetch_add(total);
+        return total;
+    }
+};
+
+// Compact binary log event; the logger thread turns it into text later
+struct LogEvent
+{
+    long long arg[5];
+    int kind;
+    int thread_id;
+};
+
+// Asynchronous logger: hot threads push LogEvents through per-thread rings and
+// the logger thread formats them to std::cout. Levels and event kinds belong to
+// the engine; anything above the current level is dropped before it is built.
+// Call flush() before synchronous output that has to appear after the events
+// logged so far.
+class AsyncLogger
+{
+public:
+    typedef std::function<void(std::ostream &, const LogEvent &)> Formatter;
+
+    ~AsyncLogger() { stop(); }
+
+    void start(Formatter event_formatter)
+    {
+        formatter = event_formatter;
+        rings.start([this](const LogEvent *events, size_t count)
+                    {
+                        std::ostringstream text;
+                        for (size_t i = 0; i < count; ++i)
+                            formatter(text, events[i]);
+                        std::cout << text.str(); });
+    }
+
+    void stop()
+    {
+        rings.stop();
+        std::cout.flush();
+    }
+
+    void setLevel(int new_level) { level.store(new_level, std::memory_order_relaxed); }
+    bool enabled(int event_level) const { return event_level <= level.load(std::memory_order_relaxed); }
+
+    void log(int event_level, int kind, long long a0 = 0, long long a1 = 0, long long a2 = 0,
+             long long a3 = 0, long long a4 = 0)
+    {
+        if (!enabled(event_level))
+            return;
+        rings.push({{a0, a1, a2, a3, a4}, kind, omp_get_thread_num()});
+    }
+
+    void flush() { rings.flush(); }
+
+private:
+    std::atomic<int> level{0}; // Quiet until setLevel()
+    ThreadRings<LogEvent> rings;
+    Formatter formatter;
+};
@@ -11,6 +11,12 @@
 #include <iomanip>
 #include <mutex>
 #include <numeric>
+#include <atomic>
+#include <cmath>
+#include <climits>
+#include <cstdio>
+
+#include "../common/lock-profile.h"
 
 enum FlowerType
 {
@@ -21,11 +27,25 @@ enum FlowerType
 
 const char *FlowerNames[3] = {"Rose", "Sunflower", "Tulip"};
 
+// Money is held as integer cents and prices as integer ticks of one cent, so
+// price drops never drift and every cent a buyer spends is accounted for
+typedef long long Cents;
+const int PRICE_DROP = 20;  // Ticks every ask falls after a round without trades
+const int PRICE_FLOOR = 20; // Asks never drop below this
+
+// Format cents (or price ticks) as dollars with two decimals
+std::string formatCents(Cents amount)
+{
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%s%lld.%02lld", amount < 0 ? "-" : "", std::llabs(amount) / 100, std::llabs(amount) % 100);
+    return buf;
+}
+
 struct Seller
 {
     char name[20];
     int quantity[3];
-    double price[3];
+    int price[3]; // Ticks
     std::string timestamp;
     int original_quantity[3]; // Track original stock for analytics
 };
@@ -35,9 +55,9 @@ struct Buyer
     char name[20];
     int demand[3];
     int original_demand[3]; // Track original demand
-    double budget;
-    double original_budget;
-    double buy_price[3];
+    Cents budget;
+    Cents original_budget;
+    int buy_price[3]; // Ticks
     std::string timestamp;
     int priority; // Higher number = higher priority
 };
@@ -48,8 +68,8 @@ struct TradeRecord
     std::string seller_name;
     int flower_type;
     int quantity;
-    double price_per_unit;
-    double total_cost;
+    int price_per_unit; // Ticks
+    Cents total_cost;
     std::string timestamp;
 };
 
@@ -59,8 +79,13 @@ private:
     std::vector<Seller> sellers;
     std::vector<Buyer> buyers;
     std::vector<TradeRecord> trade_history;
-    std::mutex trade_mutex;
-    std::mutex print_mutex;
+    ProfiledMutex trade_mutex;
+    ProfiledMutex print_mutex;
+    // Contention profiles, filled in by profileLocks(); seller_locks holds each
+    // seller's share of trade_mutex and is empty when profiling is off
+    std::vector<LockProfile> seller_locks;
+    LockProfile trade_lock, print_lock;
+    bool lock_profiling = false;
 
 public:
     // Initialize with hardcoded data
@@ -68,20 +93,43 @@ public:
     {
         // Initialize sellers with timestamps
         sellers = {
-            {"Alice", {30, 10, 20}, {6.0, 5.5, 7.0}, "2024-01-15 09:00:00", {30, 10, 20}},
-            {"Bob", {20, 20, 10}, {5.5, 5.2, 6.5}, "2024-01-15 09:30:00", {20, 20, 10}},
-            {"Charlie", {10, 5, 10}, {6.8, 5.0, 7.5}, "2024-01-15 10:00:00", {10, 5, 10}}};
+            {"Alice", {30, 10, 20}, {600, 550, 700}, "2024-01-15 09:00:00", {30, 10, 20}},
+            {"Bob", {20, 20, 10}, {550, 520, 650}, "2024-01-15 09:30:00", {20, 20, 10}},
+            {"Charlie", {10, 5, 10}, {680, 500, 750}, "2024-01-15 10:00:00", {10, 5, 10}}};
 
         // Initialize buyers with timestamps and priorities
         buyers = {
-            {"Dan", {10, 5, 2}, {10, 5, 2}, 500, 500, {4.0, 4.0, 5.0}, "2024-01-15 08:00:00", 3},
-            {"Eve", {5, 5, 0}, {5, 5, 0}, 300, 300, {3.5, 3.5, 0.0}, "2024-01-15 08:30:00", 1},
-            {"Fay", {15, 10, 5}, {15, 10, 5}, 1000, 1000, {5.0, 4.5, 5.5}, "2024-01-15 09:00:00", 2}};
+            {"Dan", {10, 5, 2}, {10, 5, 2}, 50000, 50000, {400, 400, 500}, "2024-01-15 08:00:00", 3},
+            {"Eve", {5, 5, 0}, {5, 5, 0}, 30000, 30000, {350, 350, 0}, "2024-01-15 08:30:00", 1},
+            {"Fay", {15, 10, 5}, {15, 10, 5}, 100000, 100000, {500, 450, 550}, "2024-01-15 09:00:00", 2}};
+    }
+
+    // Attach a LockProfile to every lock; call after initializeMarket
+    void profileLocks()
+    {
+        seller_locks = std::vector<LockProfile>(sellers.size());
+        trade_mutex.profile(&trade_lock);
+        print_mutex.profile(&print_lock);
+        lock_profiling = true;
+    }
+
+    void printLockContention()
+    {
+        std::cout << "\n🔒 LOCK CONTENTION:\n";
+        LockProfile::printHeader();
+        trade_lock.print("trade_mutex");
+        print_lock.print("print_mutex");
+
+        std::cout << "\n🔥 TRADE MUTEX BY SELLER (wait time, log scale):\n";
+        printLockHeatmap(seller_locks);
+        LockProfile::printHeader();
+        for (int i = 0; i < sellers.size(); ++i)
+            seller_locks[i].print(sellers[i].name);
     }
 
     void printStatus()
     {
-        std::lock_guard<std::mutex> lock(print_mutex);
+        std::lock_guard<ProfiledMutex> lock(print_mutex);
 
         std::cout << "\n"
                   << std::string(60, '=') << "\n";
@@ -96,7 +144,7 @@ public:
             {
                 std::cout << "   " << FlowerNames[i] << ": " << seller.quantity[i]
                           << "/" << seller.original_quantity[i]
-                          << " @ $" << std::fixed << std::setprecision(2) << seller.price[i] << "\n";
+                          << " @ $" << formatCents(seller.price[i]) << "\n";
             }
         }
 
@@ -111,11 +159,10 @@ public:
                 {
                     std::cout << "   " << FlowerNames[i] << ": " << buyer.demand[i]
                               << "/" << buyer.original_demand[i]
-                              << " (max $" << buyer.buy_price[i] << ")\n";
+                              << " (max $" << formatCents(buyer.buy_price[i]) << ")\n";
                 }
             }
-            std::cout << "   Budget: $" << std::fixed << std::setprecision(2)
-                      << buyer.budget << "/$" << buyer.original_budget << "\n";
+            std::cout << "   Budget: $" << formatCents(buyer.budget) << "/$" << formatCents(buyer.original_budget) << "\n";
         }
         std::cout << std::endl;
     }
@@ -241,7 +288,8 @@ public:
 
     bool executeTrade(int buyer_idx, int seller_idx, int flower, int quantity)
     {
-        std::lock_guard<std::mutex> lock(trade_mutex);
+        trade_mutex.lock(lock_profiling ? &seller_locks[seller_idx] : nullptr);
+        std::lock_guard<ProfiledMutex> lock(trade_mutex, std::adopt_lock);
 
         Buyer &buyer = buyers[buyer_idx];
         Seller &seller = sellers[seller_idx];
@@ -251,13 +299,13 @@ public:
             return false;
 
         // Check affordability
-        int affordable = static_cast<int>(buyer.budget / seller.price[flower]);
+        int affordable = (int)std::min<Cents>(buyer.budget / seller.price[flower], INT_MAX);
         int actual_quantity = std::min({affordable, buyer.demand[flower], seller.quantity[flower], quantity});
 
         if (actual_quantity <= 0)
             return false;
 
-        double cost = actual_quantity * seller.price[flower];
+        Cents cost = (Cents)actual_quantity * seller.price[flower];
 
         // Execute trade
         buyer.demand[flower] -= actual_quantity;
@@ -278,8 +326,8 @@ public:
         // Print trade info
         std::cout << "💰 " << buyer.name << " bought " << actual_quantity << " "
                   << FlowerNames[flower] << "(s) from " << seller.name
-                  << " for $" << std::fixed << std::setprecision(2) << cost
-                  << " ($" << seller.price[flower] << " each)\n";
+                  << " for $" << formatCents(cost)
+                  << " ($" << formatCents(seller.price[flower]) << " each)\n";
 
         return true;
     }
@@ -291,9 +339,9 @@ public:
         {
             for (int flower = 0; flower < 3; ++flower)
             {
-                if (sellers[i].price[flower] > 0.2)
+                if (sellers[i].price[flower] > PRICE_FLOOR)
                 {
-                    sellers[i].price[flower] = std::max(0.2, sellers[i].price[flower] - 0.2);
+                    sellers[i].price[flower] = std::max(PRICE_FLOOR, sellers[i].price[flower] - PRICE_DROP);
                 }
             }
         }
@@ -354,19 +402,22 @@ public:
         printStatus();
 
         std::cout << "\n📊 TRADE HISTORY:\n";
-        double total_revenue = 0;
+        Cents total_revenue = 0;
         for (const auto &trade : trade_history)
         {
             std::cout << "• " << trade.buyer_name << " ← " << trade.seller_name
                       << ": " << trade.quantity << " " << FlowerNames[trade.flower_type]
-                      << " @ $" << std::fixed << std::setprecision(2) << trade.price_per_unit
-                      << " = $" << trade.total_cost << "\n";
+                      << " @ $" << formatCents(trade.price_per_unit)
+                      << " = $" << formatCents(trade.total_cost) << "\n";
             total_revenue += trade.total_cost;
         }
 
-        std::cout << "\n💰 Total Market Volume: $" << std::fixed << std::setprecision(2) << total_revenue << "\n";
+        std::cout << "\n💰 Total Market Volume: $" << formatCents(total_revenue) << "\n";
         std::cout << "🏪 Total Trades: " << trade_history.size() << "\n";
 
+        if (lock_profiling)
+            printLockContention();
+
         // Market efficiency analysis
         std::cout << "\n📈 MARKET EFFICIENCY ANALYSIS:\n";
         for (int i = 0; i < buyers.size(); ++i)
@@ -388,7 +439,7 @@ public:
 
             std::cout << "• " << buyers[i].name << ": " << std::fixed << std::setprecision(1)
                       << fulfillment_rate << "% demand fulfilled, $"
-                      << std::setprecision(2) << (buyers[i].original_budget - buyers[i].budget)
+                      << formatCents(buyers[i].original_budget - buyers[i].budget)
                       << " spent\n";
         }
     }
@@ -453,13 +504,18 @@ public:
     }
 };
 
-int main()
+int main(int argc, char **argv)
 {
     FlowerMarket market;
 
     // Initialize with hardcoded data
     market.initializeMarket();
 
+    // "--profile-locks" reports lock contention per lock and per seller
+    for (int i = 1; i < argc; ++i)
+        if (strcmp(argv[i], "--profile-locks") == 0)
+            market.profileLocks();
+
     // Print initial market summary
     market.printMarketSummary();
 
@@ -13,49 +13,206 @@
 #include <numeric>
 #include <random>
 #include <atomic>
+#include <climits>
+#include <cmath>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <parallel/algorithm>
+#include <parallel/numeric>
+#include <cstdio>
+#include <functional>
+#include <deque>
+#include <fstream>
+#include <new>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <map>
+
+#include "../common/lock-profile.h"
+#include "../common/trade-log.h"
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+// Money is held as integer cents and prices as integer ticks of one cent, so a
+// balance update is a single atomic add and totals are exact whatever order
+// the fills land in
+typedef long long Cents;
+const int TICKS_PER_DOLLAR = 100;
+const int PRICE_DROP = 25;  // Ticks an unsold ask falls per round
+const int PRICE_FLOOR = 30; // Asks never drop below this
+
+int toTick(double dollars)
+{
+    long t = std::lround(dollars * TICKS_PER_DOLLAR);
+    return t < 0 ? 0 : (int)t;
+}
+
+Cents toCents(double dollars)
+{
+    return std::llround(dollars * 100);
+}
+
+// Format cents (or price ticks) as dollars with two decimals
+std::string formatCents(Cents amount)
+{
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%s%lld.%02lld", amount < 0 ? "-" : "", std::llabs(amount) / 100, std::llabs(amount) % 100);
+    return buf;
+}
+
+// Flower catalog: names are resolved to dense integer ids once when the market
+// is set up, so matching only ever indexes per-flower arrays by id
+struct FlowerCatalog
+{
+    std::vector<std::string> names;
+    std::unordered_map<std::string, int> ids;
+
+    int add(const std::string &name)
+    {
+        auto it = ids.find(name);
+        if (it != ids.end())
+            return it->second;
+        names.push_back(name);
+        return ids[name] = names.size() - 1;
+    }
+
+    int id(const std::string &name) const
+    {
+        auto it = ids.find(name);
+        return it == ids.end() ? -1 : it->second;
+    }
 
-enum FlowerType
+    int size() const { return names.size(); }
+    const char *name(int flower) const { return names[flower].c_str(); }
+};
+
+// Catalog size used when the number of flowers is only known at run time
+const size_t DynamicFlowers = 0;
+
+const size_t CACHE_LINE = 64;
+
+// Per-flower fields of an agent: a plain array when the catalog size is fixed at
+// compile time, a heap array sized from the runtime catalog otherwise
+template <typename T, size_t NumFlowers>
+struct FlowerSlots
+{
+    T slot[NumFlowers];
+
+    void allocate(int) {}
+    static constexpr int size() { return NumFlowers; }
+    T &operator[](int flower) { return slot[flower]; }
+    const T &operator[](int flower) const { return slot[flower]; }
+};
+
+// The heap block is padded by a cache line on each side, so one agent's slots
+// never share a line with another allocation
+template <typename T>
+struct FlowerSlots<T, DynamicFlowers>
 {
-    ROSE = 0,
-    SUNFLOWER = 1,
-    TULIP = 2
+    std::unique_ptr<T[]> block;
+    T *slot = nullptr;
+    int count = 0;
+
+    void allocate(int flowers)
+    {
+        const int pad = (CACHE_LINE + sizeof(T) - 1) / sizeof(T);
+        block.reset(new T[flowers + 2 * pad]());
+        slot = block.get() + pad;
+        count = flowers;
+    }
+    int size() const { return count; }
+    T &operator[](int flower) { return slot[flower]; }
+    const T &operator[](int flower) const { return slot[flower]; }
 };
 
-const char *FlowerNames[3] = {"Rose", "Sunflower", "Tulip"};
+template <typename Fn, size_t... Flower>
+inline void unrollFlowers(Fn &&fn, std::index_sequence<Flower...>)
+{
+    (fn(static_cast<int>(Flower)), ...);
+}
+
+// Calls fn(flower) for every flower id; fully unrolled for fixed catalogs
+template <size_t NumFlowers, typename Fn>
+inline void forEachFlower(int count, Fn &&fn)
+{
+    if constexpr (NumFlowers == DynamicFlowers)
+    {
+        for (int flower = 0; flower < count; ++flower)
+            fn(flower);
+    }
+    else
+    {
+        unrollFlowers(fn, std::make_index_sequence<NumFlowers>{});
+    }
+}
 
-struct Seller
+// Take up to `want` units from an atomic count without letting it go negative;
+// returns the units taken and, if asked, adds the failed CAS attempts to *retries
+inline int reserveUnits(std::atomic<int> &count, int want, int *retries = nullptr)
+{
+    int current = count.load();
+    int take;
+    int failed = 0;
+    do
+    {
+        take = std::min(current, want);
+        if (take <= 0)
+            break;
+    } while (!count.compare_exchange_weak(current, current - take) && ++failed);
+    if (retries)
+        *retries += failed;
+    return std::max(0, take);
+}
+
+// Cold per-agent metadata, read when reporting but never by a fill. It lives in
+// its own tables so the Seller and Buyer cache lines hold only matching state.
+struct SellerInfo
 {
     char name[20];
-    std::atomic<int> quantity[3];
-    double price[3];
     std::string timestamp;
-    int original_quantity[3];
-    std::atomic<double> revenue;
+    std::vector<int> original_quantity;
+};
+
+struct BuyerInfo
+{
+    char name[20];
+    std::string timestamp;
+    std::vector<int> original_demand;
+    Cents original_budget;
+    int priority;
+};
+
+// Hot per-seller state, written by every fill. Each seller fills exactly one
+// cache line, so threads trading with neighbouring sellers do not invalidate
+// each other's lines; cold fields (names, the omp lock settleLocked takes)
+// live in side tables, and the flower count comes from the slots.
+template <size_t NumFlowers>
+struct alignas(CACHE_LINE) Seller
+{
+    FlowerSlots<std::atomic<int>, NumFlowers> quantity;
+    std::atomic<Cents> revenue;
     std::atomic<int> trades_count;
-    omp_lock_t lock;
+    FlowerSlots<std::atomic<int>, NumFlowers> price; // Ticks, published under quote_seq
+    std::atomic<unsigned> quote_seq;                 // Odd while a quote update is in progress
+    std::atomic<int> contention; // Failed stock CAS attempts since the last cool-down check
+    std::atomic<bool> combining; // Hot: fills go through the seller's FlatCombiner
 
-    Seller() : revenue(0.0), trades_count(0)
+    explicit Seller(int flower_count = NumFlowers)
+        : revenue(0), trades_count(0), quote_seq(0), contention(0), combining(false)
     {
-        omp_init_lock(&lock);
+        quantity.allocate(flower_count);
+        price.allocate(flower_count);
     }
 
-    ~Seller()
-    {
-        omp_destroy_lock(&lock);
-    }
+    int flowers() const { return quantity.size(); }
 
     // Copy constructor
-    Seller(const Seller &other) : revenue(other.revenue.load()), trades_count(other.trades_count.load())
+    Seller(const Seller &other) : Seller(other.flowers())
     {
-        strcpy(name, other.name);
-        for (int i = 0; i < 3; ++i)
-        {
-            quantity[i].store(other.quantity[i].load());
-            price[i] = other.price[i];
-            original_quantity[i] = other.original_quantity[i];
-        }
-        timestamp = other.timestamp;
-        omp_init_lock(&lock);
+        *this = other;
     }
 
     // Assignment operator
@@ -63,14 +220,10 @@ struct Seller
     {
         if (this != &other)
         {
-            strcpy(name, other.name);
-            for (int i = 0; i < 3; ++i)
-            {
-                quantity[i].store(other.quantity[i].load());
-                price[i] = other.price[i];
-                original_quantity[i] = other.original_quantity[i];
-            }
-            timestamp = other.timestamp;
+            forEachFlower<NumFlowers>(flowers(), [&](int i)
+                                      {
+                                          quantity[i].store(other.quantity[i].load());
+                                          price[i].store(other.price[i].load()); });
             revenue.store(other.revenue.load());
             trades_count.store(other.trades_count.load());
         }
@@ -78,55 +231,76 @@ struct Seller
     }
 
     // Helper method to add revenue atomically
-    void addRevenue(double amount)
+    void addRevenue(Cents amount)
+    {
+        revenue.fetch_add(amount);
+    }
+
+    // Quotes are published through a seqlock. One price is a single atomic
+    // load and always valid on its own; readQuotes copies the whole set as of
+    // one moment, retrying while an update overlaps. Writers take the odd
+    // sequence with one CAS (the continuous market reprices flowers of the
+    // same seller from different threads), so they never wait on readers.
+    int quote(int flower) const
+    {
+        return price[flower].load(std::memory_order_relaxed);
+    }
+
+    void readQuotes(int *out) const
     {
-        double expected = revenue.load();
-        while (!revenue.compare_exchange_weak(expected, expected + amount))
+        unsigned before, after;
+        do
         {
-            // Keep trying until successful
-        }
+            before = quote_seq.load(std::memory_order_acquire);
+            for (int f = 0; f < flowers(); ++f)
+                out[f] = price[f].load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            after = quote_seq.load(std::memory_order_relaxed);
+        } while ((before & 1) || before != after);
+    }
+
+    // Run update(price) as one quote update
+    template <typename Update>
+    void publishQuotes(Update &&update)
+    {
+        unsigned seq = quote_seq.load(std::memory_order_relaxed);
+        while ((seq & 1) || !quote_seq.compare_exchange_weak(seq, seq + 1, std::memory_order_acquire))
+            seq = quote_seq.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        update(price);
+        quote_seq.store(seq + 2, std::memory_order_release);
+    }
+
+    void setQuote(int flower, int tick)
+    {
+        publishQuotes([&](FlowerSlots<std::atomic<int>, NumFlowers> &quotes)
+                      { quotes[flower].store(tick, std::memory_order_relaxed); });
     }
 };
+static_assert(sizeof(Seller<3>) == CACHE_LINE, "a fixed-catalog Seller must fill exactly one cache line");
 
-struct Buyer
+// Hot per-buyer state, laid out like Seller
+template <size_t NumFlowers>
+struct alignas(CACHE_LINE) Buyer
 {
-    char name[20];
-    std::atomic<int> demand[3];
-    int original_demand[3];
-    std::atomic<double> budget;
-    double original_budget;
-    double buy_price[3];
-    std::string timestamp;
-    int priority;
-    std::atomic<double> spent;
+    FlowerSlots<std::atomic<int>, NumFlowers> demand;
+    std::atomic<Cents> budget;
+    std::atomic<Cents> spent;
     std::atomic<int> purchases_count;
-    omp_lock_t lock;
+    FlowerSlots<int, NumFlowers> buy_price; // Ticks
 
-    Buyer() : spent(0.0), purchases_count(0)
+    explicit Buyer(int flower_count = NumFlowers) : spent(0), purchases_count(0)
     {
-        omp_init_lock(&lock);
+        demand.allocate(flower_count);
+        buy_price.allocate(flower_count);
     }
 
-    ~Buyer()
-    {
-        omp_destroy_lock(&lock);
-    }
+    int flowers() const { return demand.size(); }
 
     // Copy constructor
-    Buyer(const Buyer &other) : spent(other.spent.load()), purchases_count(other.purchases_count.load())
+    Buyer(const Buyer &other) : Buyer(other.flowers())
     {
-        strcpy(name, other.name);
-        for (int i = 0; i < 3; ++i)
-        {
-            demand[i].store(other.demand[i].load());
-            original_demand[i] = other.original_demand[i];
-            buy_price[i] = other.buy_price[i];
-        }
-        budget.store(other.budget.load());
-        original_budget = other.original_budget;
-        timestamp = other.timestamp;
-        priority = other.priority;
-        omp_init_lock(&lock);
+        *this = other;
     }
 
     // Assignment operator
@@ -134,170 +308,1533 @@ struct Buyer
     {
         if (this != &other)
         {
-            strcpy(name, other.name);
-            for (int i = 0; i < 3; ++i)
-            {
-                demand[i].store(other.demand[i].load());
-                original_demand[i] = other.original_demand[i];
-                buy_price[i] = other.buy_price[i];
-            }
+            forEachFlower<NumFlowers>(flowers(), [&](int i)
+                                      {
+                                          demand[i].store(other.demand[i].load());
+                                          buy_price[i] = other.buy_price[i]; });
             budget.store(other.budget.load());
-            original_budget = other.original_budget;
-            timestamp = other.timestamp;
-            priority = other.priority;
             spent.store(other.spent.load());
             purchases_count.store(other.purchases_count.load());
         }
         return *this;
     }
 
-    // Helper method to subtract from budget atomically
-    bool subtractBudget(double amount)
+    // Helper method to subtract from budget atomically; an overdraft is undone
+    // straight away, so the balance only dips below zero transiently
+    bool subtractBudget(Cents amount)
     {
-        double expected = budget.load();
-        while (expected >= amount)
+        if (budget.fetch_sub(amount) >= amount)
         {
-            if (budget.compare_exchange_weak(expected, expected - amount))
-            {
-                return true;
-            }
+            return true;
         }
+        budget.fetch_add(amount);
         return false;
     }
 
+    // Reserve the cost of up to `units` at `price` ticks each, as many as the
+    // budget covers; returns the units paid for
+    int reserveBudget(int units, int price)
+    {
+        Cents current = budget.load();
+        int paid;
+        do
+        {
+            paid = (int)std::min<Cents>(units, current / price);
+            if (paid <= 0)
+                return 0;
+        } while (!budget.compare_exchange_weak(current, current - (Cents)paid * price));
+        return paid;
+    }
+
     // Helper method to add to spent atomically
-    void addSpent(double amount)
+    void addSpent(Cents amount)
+    {
+        spent.fetch_add(amount);
+    }
+};
+static_assert(sizeof(Buyer<3>) == CACHE_LINE, "a fixed-catalog Buyer must fill exactly one cache line");
+
+// Ask book for a single flower type. Every seller with stock is linked into the
+// bucket for its price tick, and a bitmap of non-empty ticks lets bestSeller()
+// return the lowest ask in O(1) instead of scanning all sellers. Sellers within
+// a tick keep insertion order, so ties go to whoever was listed first.
+struct AskBook
+{
+    std::vector<int> head, tail;                // per tick, -1 when empty
+    std::vector<int> next, prev, sellerTick;    // per seller, sellerTick = -1 when unlisted
+    std::vector<unsigned long long> occupied;   // bit t set when tick t has sellers
+    int best = -1;                              // lowest occupied tick, -1 when book is empty
+
+    void init(int numSellers, int maxTick)
+    {
+        head.assign(maxTick + 1, -1);
+        tail.assign(maxTick + 1, -1);
+        next.assign(numSellers, -1);
+        prev.assign(numSellers, -1);
+        sellerTick.assign(numSellers, -1);
+        occupied.assign(maxTick / 64 + 1, 0ULL);
+        best = -1;
+    }
+
+    bool listed(int s) const { return sellerTick[s] >= 0; }
+    bool empty() const { return best < 0; }
+    int bestSeller() const { return best < 0 ? -1 : head[best]; }
+    int bestTick() const { return best; }
+
+    void insert(int s, int t)
+    {
+        t = std::min(t, (int)head.size() - 1);
+        sellerTick[s] = t;
+        next[s] = -1;
+        prev[s] = tail[t];
+        if (tail[t] >= 0)
+            next[tail[t]] = s;
+        else
+            head[t] = s;
+        tail[t] = s;
+        occupied[t / 64] |= 1ULL << (t % 64);
+        if (best < 0 || t < best)
+            best = t;
+    }
+
+    void erase(int s)
+    {
+        int t = sellerTick[s];
+        if (t < 0)
+            return;
+        if (prev[s] >= 0)
+            next[prev[s]] = next[s];
+        else
+            head[t] = next[s];
+        if (next[s] >= 0)
+            prev[next[s]] = prev[s];
+        else
+            tail[t] = prev[s];
+        sellerTick[s] = -1;
+
+        if (head[t] < 0)
+        {
+            occupied[t / 64] &= ~(1ULL << (t % 64));
+            if (t == best)
+                best = nextOccupied(t);
+        }
+    }
+
+    // Move a listed seller to a new price tick (used by the price-drop step)
+    void reprice(int s, int t)
+    {
+        if (!listed(s) || sellerTick[s] == t)
+            return;
+        erase(s);
+        insert(s, t);
+    }
+
+    int nextOccupied(int from) const
+    {
+        for (size_t w = from / 64; w < occupied.size(); ++w)
+        {
+            unsigned long long bits = occupied[w];
+            if (w == (size_t)from / 64)
+                bits &= ~0ULL << (from % 64);
+            if (bits)
+                return (int)(w * 64 + __builtin_ctzll(bits));
+        }
+        return -1;
+    }
+};
+
+// Parallel stream compaction: keeps the ids for which keep(id) holds, in their
+// current order. Each thread flags and counts the survivors of its own chunk,
+// a prefix sum over the counts gives every chunk its output offset, and each
+// thread then scatters its survivors there.
+template <typename Keep>
+void compactIds(std::vector<int> &ids, Keep &&keep)
+{
+    const int n = ids.size();
+    std::vector<char> flag(n);
+    std::vector<int> offset(omp_get_max_threads() + 1, 0);
+    std::vector<int> out;
+
+#pragma omp parallel
+    {
+        int t = omp_get_thread_num(), nt = omp_get_num_threads();
+        int lo = (long long)n * t / nt, hi = (long long)n * (t + 1) / nt;
+
+        int count = 0;
+        for (int i = lo; i < hi; ++i)
+            count += flag[i] = keep(ids[i]);
+        offset[t + 1] = count;
+
+#pragma omp barrier
+#pragma omp single
+        {
+            for (int k = 1; k <= nt; ++k)
+                offset[k] += offset[k - 1];
+            out.resize(offset[nt]);
+        }
+
+        int pos = offset[t];
+        for (int i = lo; i < hi; ++i)
+            if (flag[i])
+                out[pos++] = ids[i];
+    }
+
+    ids.swap(out);
+}
+
+// Buyers for one flower ordered by limit price, highest first. Asks only ever
+// fall, so the buyers whose limit covers a seller's ask are a prefix of this
+// order that only grows: each seller keeps a cursor into it and admits newly
+// covered buyers into its own eligible list, kept in priority order. Demand
+// never comes back either, so filled buyers are skipped on admission and pruned
+// from the lists, and a round touches only buyers still trading plus whatever
+// the last price drop admitted.
+struct EligibilityIndex
+{
+    std::vector<int> by_bid;               // buyer ids, highest limit first
+    std::vector<int> bid;                  // limit tick at each by_bid position
+    int head = 0;                          // positions before head have no demand left
+    std::vector<int> cursor;               // per seller, positions [0, cursor) are admitted
+    std::vector<std::vector<int>> eligible; // per seller, admitted buyers by priority rank
+
+    // limits[b] is buyer b's limit tick, rank[b] its position in priority order
+    void init(const std::vector<int> &limits, const std::vector<int> &rank, int numSellers)
+    {
+        by_bid.resize(limits.size());
+        std::iota(by_bid.begin(), by_bid.end(), 0);
+        std::sort(by_bid.begin(), by_bid.end(), [&](int a, int b)
+                  { return limits[a] != limits[b] ? limits[a] > limits[b] : rank[a] < rank[b]; });
+        bid.resize(by_bid.size());
+        for (int p = 0; p < by_bid.size(); ++p)
+            bid[p] = limits[by_bid[p]];
+        head = 0;
+        cursor.assign(numSellers, 0);
+        eligible.assign(numSellers, std::vector<int>());
+    }
+
+    // Admit every buyer whose limit now covers seller s's ask; wants(b) tells
+    // whether buyer b still has demand for this flower
+    template <typename Wants>
+    void admit(int s, int ask, const std::vector<int> &rank, Wants &&wants)
+    {
+        int from = std::max(cursor[s], head), to = from;
+        while (to < by_bid.size() && bid[to] >= ask)
+            ++to;
+        cursor[s] = std::max(cursor[s], to);
+        if (to == from)
+            return;
+
+        std::vector<int> &list = eligible[s];
+        size_t old = list.size();
+        for (int p = from; p < to; ++p)
+            if (wants(by_bid[p]))
+                list.push_back(by_bid[p]);
+
+        auto byRank = [&](int a, int b)
+        { return rank[a] < rank[b]; };
+        std::sort(list.begin() + old, list.end(), byRank);
+        std::inplace_merge(list.begin(), list.begin() + old, list.end(), byRank);
+    }
+
+    // Drop buyers whose demand is met from seller s's list
+    template <typename Wants>
+    void prune(int s, Wants &&wants)
+    {
+        std::vector<int> &list = eligible[s];
+        list.erase(std::remove_if(list.begin(), list.end(), [&](int b)
+                                  { return !wants(b); }),
+                   list.end());
+    }
+
+    // Highest limit among buyers who still want the flower, -1 if none do
+    template <typename Wants>
+    int maxBid(Wants &&wants)
+    {
+        while (head < by_bid.size() && !wants(by_bid[head]))
+            ++head;
+        return head < by_bid.size() ? bid[head] : -1;
+    }
+};
+
+// Column store of the agent fields the matching filters read, so a scan over
+// buyers touches only the columns it tests instead of whole Buyer records.
+// Buyers are laid out in priority order (id maps a position back to the buyer
+// index); seller columns are indexed by seller. The engine refreshes it from
+// the authoritative atomics once per round. Build with -mavx2 or -march=native
+// to enable the vector kernels below.
+struct AgentColumns
+{
+    std::vector<int> id;
+    std::vector<std::vector<int>> demand;
+    std::vector<Cents> budget;
+    std::vector<std::vector<int>> buy_price;
+
+    std::vector<std::vector<int>> quantity;
+    std::vector<std::vector<int>> price;
+
+    void resizeBuyers(size_t n, int flowers)
+    {
+        id.resize(n);
+        budget.resize(n);
+        demand.resize(flowers);
+        buy_price.resize(flowers);
+        for (int f = 0; f < flowers; ++f)
+        {
+            demand[f].resize(n);
+            buy_price[f].resize(n);
+        }
+    }
+
+    void resizeSellers(size_t n, int flowers)
+    {
+        quantity.resize(flowers);
+        price.resize(flowers);
+        for (int f = 0; f < flowers; ++f)
+        {
+            quantity[f].resize(n);
+            price[f].resize(n);
+        }
+    }
+};
+
+// Fused remaining-demand, eligibility and affordability test against one ask:
+// writes every position with demand > 0, buy_price >= ask and budget >= ask to
+// out in position order and returns the count. out needs room for all buyers.
+int selectEligibleScalar(const AgentColumns &cols, int flower, int ask, int *out)
+{
+    const int n = cols.id.size();
+    const int *demand = cols.demand[flower].data();
+    const int *bid = cols.buy_price[flower].data();
+    const Cents *budget = cols.budget.data();
+
+    int count = 0;
+    for (int p = 0; p < n; ++p)
+    {
+        out[count] = p;
+        count += (demand[p] > 0) & (bid[p] >= ask) & (budget[p] >= ask);
+    }
+    return count;
+}
+
+#if defined(__AVX512F__) && defined(__AVX512VL__)
+const char *SimdKernelName = "AVX-512";
+
+// 8 buyers per step; matching positions are compress-stored straight to out
+int selectEligible(const AgentColumns &cols, int flower, int ask, int *out)
+{
+    const int n = cols.id.size();
+    const int *demand = cols.demand[flower].data();
+    const int *bid = cols.buy_price[flower].data();
+    const Cents *budget = cols.budget.data();
+
+    const __m256i vask = _mm256_set1_epi32(ask);
+    const __m512i vask64 = _mm512_set1_epi64(ask);
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i step = _mm256_set1_epi32(8);
+    __m256i pos = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+
+    int count = 0;
+    int p = 0;
+    for (; p + 8 <= n; p += 8)
+    {
+        __mmask8 m = _mm256_cmpge_epi32_mask(_mm256_loadu_si256((const __m256i *)(bid + p)), vask) &
+                     _mm512_cmpge_epi64_mask(_mm512_loadu_si512(budget + p), vask64) &
+                     _mm256_cmpgt_epi32_mask(_mm256_loadu_si256((const __m256i *)(demand + p)), zero);
+        _mm256_mask_compressstoreu_epi32(out + count, m, pos);
+        count += __builtin_popcount(m);
+        pos = _mm256_add_epi32(pos, step);
+    }
+    for (; p < n; ++p)
+    {
+        out[count] = p;
+        count += (demand[p] > 0) & (bid[p] >= ask) & (budget[p] >= ask);
+    }
+    return count;
+}
+#elif defined(__AVX2__)
+const char *SimdKernelName = "AVX2";
+
+// Lane offsets of the set bits of a 4-bit mask, used to left-pack positions
+alignas(16) const int CompressLanes[16][4] = {
+    {0, 0, 0, 0}, {0, 0, 0, 0}, {1, 0, 0, 0}, {0, 1, 0, 0},
+    {2, 0, 0, 0}, {0, 2, 0, 0}, {1, 2, 0, 0}, {0, 1, 2, 0},
+    {3, 0, 0, 0}, {0, 3, 0, 0}, {1, 3, 0, 0}, {0, 1, 3, 0},
+    {2, 3, 0, 0}, {0, 2, 3, 0}, {1, 2, 3, 0}, {0, 1, 2, 3}};
+
+// 4 buyers per step; matching positions are left-packed through CompressLanes.
+// AVX2 only has signed greater-than, so each test is built from the opposite
+// comparison and cleared with andnot.
+int selectEligible(const AgentColumns &cols, int flower, int ask, int *out)
+{
+    const int n = cols.id.size();
+    const int *demand = cols.demand[flower].data();
+    const int *bid = cols.buy_price[flower].data();
+    const Cents *budget = cols.budget.data();
+
+    const __m128i vask = _mm_set1_epi32(ask);
+    const __m256i vask64 = _mm256_set1_epi64x(ask);
+    const __m128i zero = _mm_setzero_si128();
+
+    int count = 0;
+    int p = 0;
+    for (; p + 4 <= n; p += 4)
+    {
+        __m128i wants = _mm_cmpgt_epi32(_mm_loadu_si128((const __m128i *)(demand + p)), zero);
+        __m128i bid_low = _mm_cmpgt_epi32(vask, _mm_loadu_si128((const __m128i *)(bid + p)));
+        __m256i ok = _mm256_cvtepi32_epi64(_mm_andnot_si128(bid_low, wants));
+        __m256i broke = _mm256_cmpgt_epi64(vask64, _mm256_loadu_si256((const __m256i *)(budget + p)));
+        ok = _mm256_andnot_si256(broke, ok);
+
+        int m = _mm256_movemask_pd(_mm256_castsi256_pd(ok));
+        __m128i lanes = _mm_load_si128((const __m128i *)CompressLanes[m]);
+        _mm_storeu_si128((__m128i *)(out + count), _mm_add_epi32(lanes, _mm_set1_epi32(p)));
+        count += __builtin_popcount(m);
+    }
+    for (; p < n; ++p)
+    {
+        out[count] = p;
+        count += (demand[p] > 0) & (bid[p] >= ask) & (budget[p] >= ask);
+    }
+    return count;
+}
+#else
+const char *SimdKernelName = "scalar";
+
+int selectEligible(const AgentColumns &cols, int flower, int ask, int *out)
+{
+    return selectEligibleScalar(cols, flower, ask, out);
+}
+#endif
+
+// One side of a call auction: a buyer's bid or a seller's ask for one flower
+struct AuctionOrder
+{
+    int tick;
+    int quantity;
+    int agent;
+    int priority;
+};
+
+// One fill as written to the trade journal: fixed size and ids only, so it can
+// be copied into a ring buffer and written out as raw bytes
+struct TradeRecord
+{
+    long long time_ns; // Steady clock
+    Cents total_cost;
+    int buyer;
+    int seller;
+    int flower_type;
+    int quantity;
+    int price_per_unit; // Ticks
+    int thread_id;
+};
+
+// Market-wide counters, sharded per thread. Each thread adds to its own
+// cache-line shard with relaxed atomics, so the settlement path never shares a
+// counter line with another thread; reads sum the shards. Threads past the
+// shard count wrap around and share, which stays correct because shards are
+// still atomic.
+class MarketStats
+{
+public:
+    enum Counter
+    {
+        Trades,
+        Volume,            // Cents
+        OutstandingDemand, // Units still wanted; starts at total demand, fills subtract
+        ConcurrentTrades,
+        ParallelOperations,
+        CombinedFills, // Fills applied in a hot seller's flat-combining batches
+        StolenTasks, // Matching tasks a worker took from another worker's deque
+        CounterCount
+    };
+
+    MarketStats() { reset(); }
+
+    void add(Counter counter, long long amount)
+    {
+        shards[shardIndex()].value[counter].fetch_add(amount, std::memory_order_relaxed);
+    }
+
+    long long read(Counter counter) const
+    {
+        long long total = 0;
+        for (const Shard &shard : shards)
+            total += shard.value[counter].load(std::memory_order_relaxed);
+        return total;
+    }
+
+    void reset()
+    {
+        for (Shard &shard : shards)
+            for (std::atomic<long long> &value : shard.value)
+                value.store(0, std::memory_order_relaxed);
+    }
+
+private:
+    static const int Shards = 64;
+
+    struct alignas(CACHE_LINE) Shard
+    {
+        std::atomic<long long> value[CounterCount];
+    };
+    Shard shards[Shards];
+
+    static int shardIndex()
+    {
+        static std::atomic<int> next(0);
+        thread_local int index = next.fetch_add(1) % Shards;
+        return index;
+    }
+};
+
+// Trade journal: fills go through per-thread rings to a writer that appends
+// them to the journal file, or keeps them in memory when no file is given
+class TradeJournal
+{
+public:
+    ~TradeJournal() { stop(); }
+
+    // Start the writer; `path` gets the raw TradeRecords appended, nullptr keeps
+    // them in memory. `producers` is the widest team that will record.
+    bool start(const char *path, int producers = omp_get_max_threads())
+    {
+        if (path)
+        {
+            file = fopen(path, "wb");
+            if (!file)
+                return false;
+        }
+        rings.start([this](const TradeRecord *entries, size_t count)
+                    {
+                        if (file)
+                            fwrite(entries, sizeof(TradeRecord), count, file);
+                        else
+                            kept.insert(kept.end(), entries, entries + count); },
+                    producers);
+        return true;
+    }
+
+    void stop()
+    {
+        rings.stop();
+        if (file)
+        {
+            fclose(file);
+            file = nullptr;
+        }
+    }
+
+    void record(const TradeRecord &entry) { rings.push(entry); }
+    long long drained() const { return rings.drained(); }
+
+    // In-memory journal, complete once stop() has returned
+    const std::vector<TradeRecord> &records() const { return kept; }
+
+private:
+    ThreadRings<TradeRecord> rings;
+    FILE *file = nullptr;
+    std::vector<TradeRecord> kept;
+};
+
+// Log levels, set at run time with --log-level
+enum LogLevel
+{
+    LOG_QUIET = 0, // Round headers and reports only
+    LOG_INFO = 1,  // Plus per-round market events (clearing prices)
+    LOG_TRADES = 2 // Plus one line per fill
+};
+
+// Index of the thread that owns item i when n items are split with
+// schedule(static) over `threads` threads, as libgomp does
+inline int staticOwner(long long i, long long n, int threads)
+{
+    long long q = n / threads, r = n % threads;
+    return i < r * (q + 1) ? i / (q + 1) : r + (i - r * (q + 1)) / std::max(1LL, q);
+}
+
+// Agent storage placed by first touch. The elements are constructed by the
+// threads of a schedule(static) loop, so on a NUMA machine each page lands on
+// the node of the thread that matches those agents later (the engine's agent
+// loops use the same static split).
+template <typename T>
+class AgentArray
+{
+public:
+    AgentArray() {}
+    AgentArray(const AgentArray &) = delete;
+    AgentArray &operator=(const AgentArray &) = delete;
+    ~AgentArray() { clear(); }
+
+    void assign(size_t n, const T &prototype)
+    {
+        clear();
+        items = static_cast<T *>(::operator new(n * sizeof(T), std::align_val_t(alignof(T))));
+        count = n;
+#pragma omp parallel for schedule(static)
+        for (long long i = 0; i < (long long)n; ++i)
+            new (items + i) T(prototype);
+    }
+
+    void clear()
+    {
+        if (!items)
+            return;
+#pragma omp parallel for schedule(static)
+        for (long long i = 0; i < (long long)count; ++i)
+            items[i].~T();
+        ::operator delete(items, std::align_val_t(alignof(T)));
+        items = nullptr;
+        count = 0;
+    }
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    T &operator[](size_t i) { return items[i]; }
+    const T &operator[](size_t i) const { return items[i]; }
+    T *begin() { return items; }
+    T *end() { return items + count; }
+    const T *begin() const { return items; }
+    const T *end() const { return items + count; }
+
+private:
+    T *items = nullptr;
+    size_t count = 0;
+};
+
+// NUMA layout of the machine, read from /sys (one node holding every CPU
+// when that is missing), and the node each OpenMP thread runs on
+struct NumaTopology
+{
+    std::vector<std::vector<int>> node_cpus; // Usable CPUs of each node
+    std::vector<int> node_ids;               // Kernel id of each node
+    std::vector<int> worker_node;            // Node of each OpenMP thread number, -1 if unbound
+    bool pinned = false;                     // Threads 1.. were bound by the engine
+
+    int nodes() const { return node_cpus.size(); }
+    int nodeOf(int worker) const { return worker_node.empty() ? 0 : worker_node[worker % worker_node.size()]; }
+
+    void detect()
+    {
+        cpu_set_t allowed;
+        CPU_ZERO(&allowed);
+        sched_getaffinity(0, sizeof(allowed), &allowed);
+
+        node_cpus.clear();
+        node_ids.clear();
+        for (int node = 0;; ++node)
+        {
+            std::ifstream list("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+            if (!list)
+                break;
+            std::vector<int> cpus;
+            std::string range;
+            while (std::getline(list, range, ','))
+            {
+                int lo = 0, hi = -1;
+                if (sscanf(range.c_str(), "%d-%d", &lo, &hi) < 2)
+                    hi = lo;
+                for (int cpu = lo; cpu <= hi; ++cpu)
+                    if (CPU_ISSET(cpu, &allowed))
+                        cpus.push_back(cpu);
+            }
+            if (!cpus.empty())
+            {
+                node_cpus.push_back(cpus);
+                node_ids.push_back(node);
+            }
+        }
+        if (node_cpus.empty())
+        {
+            node_cpus.emplace_back();
+            node_ids.push_back(0);
+            for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+                if (CPU_ISSET(cpu, &allowed))
+                    node_cpus.back().push_back(cpu);
+        }
+    }
+
+    // Node index of the memory behind each address, asked of the kernel with
+    // move_pages(2) in query mode; -1 where it cannot say, and nodes() for
+    // memory on a node without usable CPUs (remote to every thread)
+    template <typename T>
+    std::vector<int> pageNodes(const T *items, size_t count) const
+    {
+        std::vector<void *> pages(count);
+        for (size_t i = 0; i < count; ++i)
+            pages[i] = const_cast<T *>(items + i);
+        std::vector<int> status(count, -1);
+        if (count == 0 || syscall(SYS_move_pages, 0, count, pages.data(), nullptr, status.data(), 0) != 0)
+            return std::vector<int>(count, -1);
+        for (int &node : status)
+        {
+            if (node < 0)
+                continue;
+            auto id = std::find(node_ids.begin(), node_ids.end(), node);
+            node = id == node_ids.end() ? nodes() : (int)(id - node_ids.begin());
+        }
+        return status;
+    }
+
+    // Pin OpenMP thread t to the t-th usable CPU in node order (close binding,
+    // so neighbouring static chunks share a node), unless the user already
+    // chose places or binding through the OpenMP environment. The master only
+    // keeps its CPU for the detection: threads created later inherit its mask,
+    // so it gets its original mask back afterwards and counts as unbound
+    // (node -1); OMP_PLACES/OMP_PROC_BIND bind it as well.
+    void bindThreads(int threads)
+    {
+        bool bind = !getenv("OMP_PROC_BIND") && !getenv("OMP_PLACES");
+        std::vector<int> order;
+        for (const std::vector<int> &cpus : node_cpus)
+            order.insert(order.end(), cpus.begin(), cpus.end());
+
+        cpu_set_t master_mask;
+        CPU_ZERO(&master_mask);
+        if (bind && sched_getaffinity(0, sizeof(master_mask), &master_mask) != 0)
+            bind = false;
+
+        std::atomic<bool> all_pinned(bind);
+        worker_node.assign(threads, 0);
+#pragma omp parallel num_threads(threads)
+        {
+            int t = omp_get_thread_num();
+            if (bind)
+            {
+                cpu_set_t one;
+                CPU_ZERO(&one);
+                CPU_SET(order[t % order.size()], &one);
+                if (sched_setaffinity(0, sizeof(one), &one) != 0)
+                    all_pinned = false;
+            }
+            int cpu = sched_getcpu();
+            for (int node = 0; node < nodes(); ++node)
+                if (std::find(node_cpus[node].begin(), node_cpus[node].end(), cpu) != node_cpus[node].end())
+                    worker_node[t] = node;
+        }
+
+        if (bind && sched_setaffinity(0, sizeof(master_mask), &master_mask) != 0)
+            perror("sched_setaffinity");
+        if (bind)
+            worker_node[0] = -1;
+        pinned = all_pinned.load() && threads > 1; // A lone master ends up unbound
+        if (bind && !all_pinned)
+            std::cerr << "Could not pin every OpenMP thread; the rest are placed by the OS\n";
+    }
+};
+
+// Per-node matching traffic: agent accesses by the node's threads, split by
+// whether the agent's memory was first touched on the same node, and the
+// bytes of agent state those accesses cover
+class NodeCounters
+{
+public:
+    void reset(int nodes) { node.reset(new Node[std::max(1, nodes)]); count = std::max(1, nodes); }
+    int nodes() const { return count; }
+
+    // Threads and agents with no fixed node (-1) are left out
+    void access(int from, int home, long long bytes)
+    {
+        if (from < 0 || home < 0)
+            return;
+        Node &n = node[from];
+        (from == home ? n.local : n.remote).fetch_add(1, std::memory_order_relaxed);
+        n.bytes.fetch_add(bytes, std::memory_order_relaxed);
+    }
+
+    long long local(int n) const { return node[n].local.load(); }
+    long long remote(int n) const { return node[n].remote.load(); }
+    long long bytes(int n) const { return node[n].bytes.load(); }
+
+private:
+    struct alignas(CACHE_LINE) Node
+    {
+        std::atomic<long long> local{0}, remote{0}, bytes{0};
+    };
+    std::unique_ptr<Node[]> node;
+    int count = 0;
+};
+
+// Runtime tuner for the engine's parallel loops. A named region first tries
+// thread counts, halving from the maximum, under the default static schedule;
+// if static left the threads unevenly loaded at the best count (slowest
+// thread over Imbalance times the mean), it then tries dynamic, guided and
+// chunked schedules there. Each candidate runs Samples times and is scored
+// by its mean region time. Settled choices are saved to the tuning file and
+// used as they are by later runs. Without a file every region runs static on
+// all threads.
+class LoopTuner
+{
+public:
+    struct Choice
+    {
+        int threads;
+        omp_sched_t kind;
+        int chunk; // 0 = the schedule's default
+
+        bool operator==(const Choice &other) const
+        {
+            return threads == other.threads && kind == other.kind && chunk == other.chunk;
+        }
+    };
+
+    bool enabled() const { return !path.empty(); }
+
+    // Use `file` for the settled choices, loading any it already holds
+    void open(const std::string &file)
+    {
+        path = file;
+        std::ifstream in(path);
+        std::string line, name;
+        int threads, kind, chunk;
+        while (std::getline(in, line))
+        {
+            std::istringstream fields(line);
+            if (line.empty() || line[0] == '#' || !(fields >> name >> threads >> kind >> chunk))
+                continue;
+            // A damaged file must not hand omp_set_schedule an unknown kind
+            if ((kind != omp_sched_static && kind != omp_sched_dynamic && kind != omp_sched_guided &&
+                 kind != omp_sched_auto) ||
+                chunk < 0)
+                continue;
+            Region &region = regions[name];
+            region.best = {std::max(1, std::min(threads, omp_get_max_threads())), (omp_sched_t)kind, chunk};
+            region.settled = region.loaded = true;
+        }
+    }
+
+    void save() const
+    {
+        if (!enabled())
+            return;
+        std::ofstream out(path);
+        out << "# loop@flowersxsellersxbuyers threads schedule chunk (schedule: 1 static, 2 dynamic, 3 guided, 4 auto)\n";
+        for (const auto &entry : regions)
+            if (entry.second.settled)
+                out << entry.first << " " << entry.second.best.threads << " " << (int)entry.second.best.kind
+                    << " " << entry.second.best.chunk << "\n";
+    }
+
+    // Settings for the next run of a region; threads_only keeps the schedule
+    // static for regions that schedule their own work
+    Choice choose(const std::string &name, bool threads_only = false)
+    {
+        if (!enabled())
+            return {omp_get_max_threads(), omp_sched_static, 0};
+
+        Region &region = regions[name];
+        if (region.settled)
+            return region.best;
+        if (region.tried.empty())
+        {
+            region.threads_only = threads_only;
+            for (int threads = omp_get_max_threads(); threads >= 1; threads /= 2)
+                region.tried.push_back({{threads, omp_sched_static, 0}});
+        }
+        return region.tried[region.current].choice;
+    }
+
+    // Account one run of a region made with `choice`; a run made with
+    // anything but the candidate under measurement is not counted
+    void record(const std::string &name, const Choice &choice, double seconds, double imbalance)
+    {
+        if (!enabled())
+            return;
+        Region &region = regions[name];
+        if (region.settled || region.current >= region.tried.size() || !(region.tried[region.current].choice == choice))
+            return;
+
+        Candidate &candidate = region.tried[region.current];
+        candidate.seconds += seconds;
+        candidate.imbalance = std::max(candidate.imbalance, imbalance);
+        if (++candidate.runs < Samples || ++region.current < region.tried.size())
+            return;
+
+        auto best = std::min_element(region.tried.begin(), region.tried.end(), [](const Candidate &a, const Candidate &b)
+                                     { return a.seconds < b.seconds; });
+        region.best = best->choice;
+        if (region.exploring_schedules || region.threads_only || best->imbalance < Imbalance || best->choice.threads == 1)
+        {
+            region.settled = true;
+            return;
+        }
+
+        // Uneven under static: try schedules that rebalance at the best thread count
+        int threads = best->choice.threads;
+        region.exploring_schedules = true;
+        for (Choice next : {Choice{threads, omp_sched_dynamic, 1}, Choice{threads, omp_sched_dynamic, 16},
+                            Choice{threads, omp_sched_guided, 1}, Choice{threads, omp_sched_static, 1}})
+            region.tried.push_back({next});
+    }
+
+    void report() const
     {
-        double expected = spent.load();
-        while (!spent.compare_exchange_weak(expected, expected + amount))
+        static const char *kinds[] = {"auto", "static", "dynamic", "guided"};
+        for (const auto &entry : regions)
         {
-            // Keep trying until successful
+            const Choice &best = entry.second.best;
+            std::cout << "   " << entry.first << ": ";
+            if (!entry.second.settled)
+            {
+                std::cout << "still exploring (" << entry.second.current << "/" << entry.second.tried.size()
+                          << " candidates measured)\n";
+                continue;
+            }
+            std::cout << best.threads << " threads, " << kinds[best.kind & 3];
+            if (best.chunk > 0)
+                std::cout << "," << best.chunk;
+            std::cout << (entry.second.loaded ? " (from tuning file)\n" : " (tuned this run)\n");
         }
     }
+
+private:
+    static const int Samples = 3;
+    static constexpr double Imbalance = 1.25;
+
+    struct Candidate
+    {
+        Choice choice;
+        double seconds = 0;
+        double imbalance = 0;
+        int runs = 0;
+    };
+
+    struct Region
+    {
+        std::vector<Candidate> tried;
+        int current = 0;
+        bool threads_only = false;
+        bool exploring_schedules = false;
+        bool settled = false;
+        bool loaded = false;
+        Choice best = {1, omp_sched_static, 0};
+    };
+
+    std::string path;
+    std::map<std::string, Region> regions;
+};
+
+// Flat-combining publication list for one hot seller. Rather than every
+// thread retrying CAS on the seller's stock, each publishes its request in
+// its own slot; whichever thread takes the combiner then applies every
+// pending request in one pass, in buyer priority order, while the others
+// wait for their slot to be marked done.
+struct FlatCombiner
+{
+    enum SlotState
+    {
+        Idle,
+        Claimed, // Owner is filling in the request
+        Pending, // Waiting for a combiner
+        Done     // granted holds the units sold
+    };
+
+    struct alignas(CACHE_LINE) Slot
+    {
+        std::atomic<int> state{Idle};
+        int flower;
+        int quantity;
+        int price; // Ticks
+        int rank;  // Buyer priority rank; lower goes first
+        int granted;
+    };
+
+    static const int Slots = 64; // Requests are published in the slot of their OpenMP thread number
+
+    Slot slot[Slots];
+    std::atomic<bool> busy{false};       // Held by the thread currently combining
+    std::atomic<long long> requests{0};  // Since the last cool-down check
+    std::atomic<long long> batches{0};
+};
+
+// Work-stealing pool for one parallel phase. Each worker owns a deque: it
+// pushes and pops its own tasks at the back (newest first, still in cache)
+// and, once that runs dry, steals from the front of another worker's deque
+// (oldest first, usually the most work left behind it). Tasks may spawn
+// follow-up tasks; run() returns when every task, spawned ones included, is done.
+template <typename Task>
+class WorkStealingPool
+{
+public:
+    explicit WorkStealingPool(int workers, const NumaTopology *numa = nullptr, LockProfile *deque_profile = nullptr)
+        : deques(std::max(1, workers)), topology(numa)
+    {
+        for (Deque &deque : deques)
+            deque.mutex.profile(deque_profile);
+    }
+
+    int workers() const { return deques.size(); }
+
+    // Queue a task on a worker's deque; from inside run(), pass the running worker
+    void spawn(int worker, const Task &task)
+    {
+        pending.fetch_add(1, std::memory_order_relaxed);
+        std::lock_guard<ProfiledMutex> lock(deques[worker].mutex);
+        deques[worker].tasks.push_back(task);
+    }
+
+    // Run every queued task on the pool's workers; body(task, worker) executes one
+    template <typename Body>
+    void run(Body &&body)
+    {
+#pragma omp parallel num_threads(workers())
+        {
+            int self = omp_get_thread_num();
+            Task task;
+            while (pending.load(std::memory_order_acquire) > 0)
+            {
+                if (!popOwn(self, task) && !steal(self, task))
+                {
+                    std::this_thread::yield(); // Another worker may still spawn
+                    continue;
+                }
+                body(task, self);
+                pending.fetch_sub(1, std::memory_order_acq_rel);
+            }
+        }
+    }
+
+    long long steals() const { return stolen.load(); }
+
+private:
+    struct alignas(CACHE_LINE) Deque
+    {
+        ProfiledMutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<Deque> deques;
+    const NumaTopology *topology;      // When given, thieves try their own node first
+    std::atomic<long long> pending{0}; // Queued or running tasks
+    std::atomic<long long> stolen{0};
+
+    bool popOwn(int self, Task &task)
+    {
+        Deque &own = deques[self];
+        std::lock_guard<ProfiledMutex> lock(own.mutex);
+        if (own.tasks.empty())
+            return false;
+        task = own.tasks.back();
+        own.tasks.pop_back();
+        return true;
+    }
+
+    bool steal(int self, Task &task)
+    {
+        for (int pass = topology ? 0 : 1; pass < 2; ++pass)
+            for (int k = 1; k < workers(); ++k)
+            {
+                int other = (self + k) % workers();
+                bool same_node = !topology || topology->nodeOf(other) == topology->nodeOf(self);
+                if (pass == 0 ? !same_node : (topology && same_node))
+                    continue;
+                if (stealFrom(other, task))
+                    return true;
+            }
+        return false;
+    }
+
+    bool stealFrom(int other, Task &task)
+    {
+        Deque &victim = deques[other];
+        std::lock_guard<ProfiledMutex> lock(victim.mutex);
+        if (victim.tasks.empty())
+            return false;
+        task = victim.tasks.front();
+        victim.tasks.pop_front();
+        stolen.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+};
+
+// Bounded single-producer single-consumer queue between two cores of the
+// shared-nothing backend; push and pop never block and fail when full or empty
+template <typename T, int Capacity = 1024>
+class SpscQueue
+{
+public:
+    bool push(const T &item)
+    {
+        unsigned long long head = head_.load(std::memory_order_relaxed);
+        if (head - tail_.load(std::memory_order_acquire) >= Capacity)
+            return false;
+        slot[head & (Capacity - 1)] = item;
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T &item)
+    {
+        unsigned long long tail = tail_.load(std::memory_order_relaxed);
+        if (tail == head_.load(std::memory_order_acquire))
+            return false;
+        item = slot[tail & (Capacity - 1)];
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Rewind an idle queue; neither side may be using it
+    void reset()
+    {
+        head_.store(0, std::memory_order_relaxed);
+        tail_.store(0, std::memory_order_relaxed);
+    }
+
+private:
+    alignas(CACHE_LINE) std::atomic<unsigned long long> head_{0};
+    alignas(CACHE_LINE) std::atomic<unsigned long long> tail_{0};
+    T slot[Capacity];
 };
 
-struct TradeRecord
+// Message between cores of the shared-nothing backend. An Order carries
+// units whose budget the buyer's home core has already escrowed; the seller's
+// core answers with a Fill saying how many of them it sold.
+struct CoreMessage
 {
-    std::string buyer_name;
-    std::string seller_name;
-    int flower_type;
+    enum Kind
+    {
+        Order,
+        Fill
+    };
+
+    int kind;
+    int buyer;
+    int seller;
+    int flower;
     int quantity;
-    double price_per_unit;
-    double total_cost;
-    std::string timestamp;
-    int thread_id;
+    int price; // Ticks
+    int filled;
 };
 
+template <size_t NumFlowers>
 class FlowerMarket
 {
 private:
-    std::vector<Seller> sellers;
-    std::vector<Buyer> buyers;
-    std::vector<TradeRecord> trade_history;
-    std::mutex trade_mutex;
-    std::mutex print_mutex;
-    std::mutex history_mutex;
-    std::atomic<int> total_trades;
-    std::atomic<double> total_volume;
+    typedef ::Seller<NumFlowers> Seller;
+    typedef ::Buyer<NumFlowers> Buyer;
+
+    FlowerCatalog catalog;
+    int flowers; // Catalog size; equals NumFlowers unless the catalog is runtime-sized
+    AgentArray<Seller> sellers; // First-touched by the threads that match them
+    AgentArray<Buyer> buyers;
+    std::vector<SellerInfo> seller_info; // Cold metadata, indexed like sellers
+    std::vector<BuyerInfo> buyer_info;   // Cold metadata, indexed like buyers
+    TradeJournal journal;
+    std::string journal_path;
+    AsyncLogger logger;
+    std::vector<AskBook> ask_books; // One per flower, sellers ordered by price tick
+    AgentColumns columns;           // Column snapshot for the market analysis kernels
+    std::vector<EligibilityIndex> eligibility; // One per flower, buyers ordered by limit
+    std::vector<int> buyer_rank;               // Each buyer's position in priority order
+    std::vector<int> active_buyers;            // Buyers with demand left, compacted each round
+    std::vector<int> active_sellers;           // Sellers with stock left, compacted each round
+    std::vector<std::unique_ptr<FlatCombiner>> combiners; // One per seller, used while it is hot
+    // Shared-nothing message rings, core_queues[from * queue_cores + to]; built
+    // once for the team and rewound between rounds
+    std::vector<std::unique_ptr<SpscQueue<CoreMessage>>> core_queues;
+    int queue_cores = 0;
+    ProfiledMutex trade_mutex;
+    ProfiledMutex print_mutex;
+    // Contention profiles, filled in by profileLocks(); seller and buyer
+    // profiles are indexed like the agents and empty when profiling is off
+    std::vector<LockProfile> seller_locks;
+    std::vector<LockProfile> buyer_locks;
+    // Per-agent omp locks, taken only by settleLocked; kept out of the hot
+    // agent structs and sized by allocateAgentLocks() whenever the agents are
+    std::unique_ptr<ProfiledOmpLock[]> seller_mutexes, buyer_mutexes;
+    LockProfile trade_lock, print_lock, deque_lock;
+    bool lock_profiling = false;
+    MarketStats market_stats;
+    NumaTopology numa;
+    NodeCounters node_traffic;
+    std::vector<int> seller_home, buyer_home; // Node each agent's memory is on, see locateAgents()
+    bool homes_queried = false;               // The kernel reported at least one agent's node
+    double match_seconds = 0; // Time spent in the work-stealing matching phase
+    LoopTuner tuner;
+
+public:
+    // When set, each round clears as a uniform-price call auction instead of pairwise matching
+    bool call_auction = false;
+    // When set, sellers whose stock CAS keeps failing switch to flat combining
+    bool flat_combining = true;
+    // When set, rounds run on the thread-per-core shared-nothing backend
+    bool shared_nothing = false;
+    // When set, rounds use deterministic intent/resolve matching
+    bool deterministic = false;
+    // Nonzero: agents are generated from this seed instead of std::random_device
+    unsigned seed = 0;
+
+    // Start the trade journal writer; fills go to `path` as raw TradeRecords,
+    // or stay in memory when path is nullptr
+    bool openJournal(const char *path)
+    {
+        journal_path = path ? path : "";
+        return journal.start(path);
+    }
+
+    // Aggregated counters; safe to read from any thread while the market runs
+    const MarketStats &stats() const { return market_stats; }
+
+    // Log event kinds; the logger thread formats them with the agents' names
+    enum LogKind
+    {
+        FillEvent,   // buyer, seller, flower, quantity, price tick
+        ClearedEvent // flower, clearing tick, volume
+    };
 
-    // Parallel processing statistics
-    std::atomic<int> parallel_operations;
-    std::atomic<int> concurrent_trades;
+    // Start the logger thread at the given LogLevel; can be changed while running
+    void startLogging(int level)
+    {
+        logger.setLevel(level);
+        logger.start([this](std::ostream &out, const LogEvent &event)
+                     {
+                         const long long *a = event.arg;
+                         if (event.kind == FillEvent)
+                             out << " [T" << event.thread_id << "] " << buyer_info[a[0]].name
+                                 << " bought " << a[3] << " " << catalog.name(a[2])
+                                 << "(s) from " << seller_info[a[1]].name << " for $" << formatCents(a[3] * a[4])
+                                 << " ($" << formatCents(a[4]) << " each)\n";
+                         else if (event.kind == ClearedEvent)
+                             out << " " << catalog.name(a[0]) << " cleared at $" << formatCents(a[1]) << ": "
+                                 << a[2] << " units matched\n"; });
+    }
 
-    // Helper method to add to total volume atomically
-    void addToTotalVolume(double amount)
+    void setLogLevel(int level) { logger.setLevel(level); }
+
+    explicit FlowerMarket(const FlowerCatalog &flower_catalog)
+        : catalog(flower_catalog), flowers(flower_catalog.size())
     {
-        double expected = total_volume.load();
-        while (!total_volume.compare_exchange_weak(expected, expected + amount))
+        if (NumFlowers != DynamicFlowers && flowers != (int)NumFlowers)
         {
-            // Keep trying until successful
+            std::cerr << "Catalog has " << flowers << " flowers, engine was built for " << NumFlowers << "\n";
+            std::exit(1);
         }
     }
 
-public:
-    FlowerMarket() : total_trades(0), total_volume(0.0), parallel_operations(0), concurrent_trades(0) {}
-
     void initializeMarket()
     {
         std::cout << "Initializing market with " << omp_get_max_threads() << " threads available\n";
 
+        // Bind the threads before any agent is touched, so first touch places
+        // each agent on the node of the thread that will match it
+        numa.detect();
+        numa.bindThreads(omp_get_max_threads());
+        node_traffic.reset(numa.nodes());
+
         // Initialize sellers
-        sellers.resize(5);
+        sellers.assign(5, Seller(flowers));
+        seller_info.assign(sellers.size(), SellerInfo());
         std::vector<std::string> seller_names = {"Alice", "Bob", "Charlie", "Diana", "Edward"};
 
 #pragma omp parallel for
         for (int i = 0; i < sellers.size(); ++i)
         {
-            strcpy(sellers[i].name, seller_names[i].c_str());
+            strcpy(seller_info[i].name, seller_names[i].c_str());
+            seller_info[i].original_quantity.resize(flowers);
 
             // Random but balanced initial quantities
             std::random_device rd;
-            std::mt19937 gen(rd() + i);
+            std::mt19937 gen((seed ? seed : rd()) + i);
             std::uniform_int_distribution<> qty_dist(15, 40);
             std::uniform_real_distribution<> price_dist(4.0, 8.0);
 
-            for (int j = 0; j < 3; ++j)
+            for (int j = 0; j < flowers; ++j)
             {
                 int qty = qty_dist(gen);
                 sellers[i].quantity[j].store(qty);
-                sellers[i].original_quantity[j] = qty;
-                sellers[i].price[j] = price_dist(gen);
+                seller_info[i].original_quantity[j] = qty;
+                sellers[i].setQuote(j, toTick(price_dist(gen)));
             }
 
-            sellers[i].timestamp = getCurrentTimestamp();
-            sellers[i].revenue.store(0.0);
+            seller_info[i].timestamp = getCurrentTimestamp();
+            sellers[i].revenue.store(0);
             sellers[i].trades_count.store(0);
         }
 
+        buildAskBooks();
+        resetCombiners();
+
         // Initialize buyers
-        buyers.resize(8);
+        buyers.assign(8, Buyer(flowers));
+        buyer_info.assign(buyers.size(), BuyerInfo());
         std::vector<std::string> buyer_names = {"Dan", "Eve", "Fay", "Grace", "Henry", "Ivy", "Jack", "Kate"};
 
 #pragma omp parallel for
         for (int i = 0; i < buyers.size(); ++i)
         {
-            strcpy(buyers[i].name, buyer_names[i].c_str());
+            strcpy(buyer_info[i].name, buyer_names[i].c_str());
+            buyer_info[i].original_demand.resize(flowers);
 
             std::random_device rd;
-            std::mt19937 gen(rd() + i + 100);
+            std::mt19937 gen((seed ? seed : rd()) + i + 100);
             std::uniform_int_distribution<> demand_dist(5, 20);
             std::uniform_real_distribution<> budget_dist(200, 800);
             std::uniform_real_distribution<> price_dist(3.0, 7.0);
             std::uniform_int_distribution<> priority_dist(1, 5);
 
-            for (int j = 0; j < 3; ++j)
+            for (int j = 0; j < flowers; ++j)
             {
                 int demand = demand_dist(gen);
                 buyers[i].demand[j].store(demand);
-                buyers[i].original_demand[j] = demand;
-                buyers[i].buy_price[j] = price_dist(gen);
+                buyer_info[i].original_demand[j] = demand;
+                buyers[i].buy_price[j] = toTick(price_dist(gen));
             }
 
-            double budget = budget_dist(gen);
+            Cents budget = toCents(budget_dist(gen));
             buyers[i].budget.store(budget);
-            buyers[i].original_budget = budget;
-            buyers[i].priority = priority_dist(gen);
-            buyers[i].timestamp = getCurrentTimestamp();
-            buyers[i].spent.store(0.0);
+            buyer_info[i].original_budget = budget;
+            buyer_info[i].priority = priority_dist(gen);
+            buyer_info[i].timestamp = getCurrentTimestamp();
+            buyers[i].spent.store(0);
             buyers[i].purchases_count.store(0);
         }
+
+        buildEligibilityIndex();
+
+        long long demand = 0;
+#pragma omp parallel for reduction(+ : demand)
+        for (int i = 0; i < buyers.size(); ++i)
+            for (int j = 0; j < flowers; ++j)
+                demand += buyer_info[i].original_demand[j];
+        market_stats.add(MarketStats::OutstandingDemand, demand);
+
+        active_buyers.resize(buyers.size());
+        std::iota(active_buyers.begin(), active_buyers.end(), 0);
+        active_sellers.resize(sellers.size());
+        std::iota(active_sellers.begin(), active_sellers.end(), 0);
+        compactActive();
+        allocateAgentLocks();
+        locateAgents();
+
+        if (shared_nothing)
+        {
+#pragma omp parallel num_threads(std::max(1, omp_get_max_threads()))
+            prepareCoreQueues();
+        }
+    }
+
+    // Tune the engine's loops and keep the choices in `path` for later runs
+    void openTuning(const char *path) { tuner.open(path); }
+
+    // Attach a LockProfile to every lock the market takes; call after
+    // initializeMarket, which rebuilds the agents and their locks
+    void profileLocks()
+    {
+        seller_locks = std::vector<LockProfile>(sellers.size());
+        buyer_locks = std::vector<LockProfile>(buyers.size());
+        trade_mutex.profile(&trade_lock);
+        print_mutex.profile(&print_lock);
+        lock_profiling = true;
+        allocateAgentLocks();
+    }
+
+    // One settleLocked lock per agent, profiled when lock profiling is on
+    void allocateAgentLocks()
+    {
+        seller_mutexes.reset(new ProfiledOmpLock[sellers.size()]);
+        buyer_mutexes.reset(new ProfiledOmpLock[buyers.size()]);
+        if (!lock_profiling)
+            return;
+        if (seller_locks.size() != sellers.size())
+            seller_locks = std::vector<LockProfile>(sellers.size());
+        if (buyer_locks.size() != buyers.size())
+            buyer_locks = std::vector<LockProfile>(buyers.size());
+        for (int i = 0; i < sellers.size(); ++i)
+            seller_mutexes[i].profile(&seller_locks[i]);
+        for (int i = 0; i < buyers.size(); ++i)
+            buyer_mutexes[i].profile(&buyer_locks[i]);
+    }
+
+    // Per-lock table, then a heatmap of the sellers and the hottest of them.
+    // Fills no longer lock a seller, so seller heat is the stock CAS retries
+    // and the waits on its flat combiner.
+    void printLockContention()
+    {
+        LockProfile all_sellers, all_buyers;
+        for (const LockProfile &profile : seller_locks)
+            all_sellers.add(profile);
+        for (const LockProfile &profile : buyer_locks)
+            all_buyers.add(profile);
+
+        std::cout << "\n LOCK CONTENTION:\n";
+        LockProfile::printHeader();
+        trade_lock.print("trade_mutex");
+        print_lock.print("print_mutex");
+        deque_lock.print("work deques");
+        all_sellers.print("seller locks (all)");
+        all_buyers.print("buyer locks (all)");
+
+        std::cout << "\n SELLER CONTENTION HEATMAP (wait time + CAS retries, log scale):\n";
+        printLockHeatmap(seller_locks);
+
+        std::vector<int> hottest(sellers.size());
+        std::iota(hottest.begin(), hottest.end(), 0);
+        int shown = std::min<int>(5, hottest.size());
+        std::partial_sort(hottest.begin(), hottest.begin() + shown, hottest.end(), [&](int a, int b)
+                          { return seller_locks[a].heat() > seller_locks[b].heat(); });
+        std::cout << "\n HOTTEST SELLERS:\n";
+        LockProfile::printHeader();
+        for (int k = 0; k < shown && seller_locks[hottest[k]].heat() > 0; ++k)
+            seller_locks[hottest[k]].print(seller_info[hottest[k]].name);
+    }
+
+    // Tuning region of a loop for this market mix: the best settings move with
+    // the catalog and the number of agents, so each mix is tuned separately
+    std::string tuningRegion(const char *loop) const
+    {
+        return std::string(loop) + "@" + std::to_string(flowers) + "x" + std::to_string(sellers.size()) + "x" +
+               std::to_string(buyers.size());
+    }
+
+    // Run body(i) for every i in [0, n) as the tuned loop `region`, timing the
+    // region and each thread's share of it for the tuner
+    template <typename Body>
+    void tunedFor(const char *loop, int n, Body &&body)
+    {
+        std::string region = tuningRegion(loop);
+        LoopTuner::Choice choice = tuner.choose(region);
+        omp_set_schedule(choice.kind, choice.chunk);
+        std::vector<double> busy(choice.threads, 0.0);
+        double start = omp_get_wtime();
+#pragma omp parallel num_threads(choice.threads)
+        {
+            double begin = omp_get_wtime();
+#pragma omp for schedule(runtime) nowait
+            for (int i = 0; i < n; ++i)
+                body(i);
+            busy[omp_get_thread_num()] = omp_get_wtime() - begin;
+        }
+        double seconds = omp_get_wtime() - start;
+        double mean = std::accumulate(busy.begin(), busy.end(), 0.0) / busy.size();
+        tuner.record(region, choice, seconds, mean > 0 ? *std::max_element(busy.begin(), busy.end()) / mean : 1.0);
+    }
+
+    // NUMA node holding agent i of n, i.e. the node of the thread that first
+    // touched it; -1 when that thread was the unbound master
+    int homeNode(long long i, long long n) const
+    {
+        return numa.nodeOf(staticOwner(i, n, omp_get_max_threads()));
+    }
+
+    // Where the kernel actually placed each agent, queried once the agents are
+    // built; the first-touch model above stands in wherever it cannot say
+    void locateAgents()
+    {
+        seller_home = numa.pageNodes(sellers.begin(), sellers.size());
+        buyer_home = numa.pageNodes(buyers.begin(), buyers.size());
+        homes_queried = false;
+        for (int s = 0; s < sellers.size(); ++s)
+            if (seller_home[s] < 0)
+                seller_home[s] = homeNode(s, sellers.size());
+            else
+                homes_queried = true;
+        for (int b = 0; b < buyers.size(); ++b)
+            if (buyer_home[b] < 0)
+                buyer_home[b] = homeNode(b, buyers.size());
+            else
+                homes_queried = true;
+    }
+
+    void resetCombiners()
+    {
+        combiners.resize(sellers.size());
+        for (std::unique_ptr<FlatCombiner> &combiner : combiners)
+            combiner.reset(new FlatCombiner());
+    }
+
+    // Once per round: a seller turns hot when its stock CAS failed HotSeller
+    // times since the last check, and cools again once its combiner's batches
+    // average under two requests, i.e. there is nothing left to combine
+    void coolSellers()
+    {
+        const int HotSeller = 32;
+#pragma omp parallel for
+        for (int i = 0; i < sellers.size(); ++i)
+        {
+            Seller &seller = sellers[i];
+            FlatCombiner &combiner = *combiners[i];
+            long long requests = combiner.requests.exchange(0), batches = combiner.batches.exchange(0);
+            if (seller.combining.load())
+                seller.combining.store(requests >= 2 * batches && requests > 0);
+            else if (seller.contention.load() >= HotSeller)
+                seller.combining.store(flat_combining);
+            seller.contention.store(0);
+        }
+    }
+
+    // Drop buyers whose demand is met and sellers who are sold out; neither
+    // ever comes back, so later passes only visit agents still trading
+    void compactActive()
+    {
+        compactIds(active_buyers, [this](int i)
+                   {
+                       bool wants = false;
+                       forEachFlower<NumFlowers>(flowers, [&](int j)
+                                                 { wants |= buyers[i].demand[j].load() > 0; });
+                       return wants; });
+        compactIds(active_sellers, [this](int i)
+                   {
+                       bool stocked = false;
+                       forEachFlower<NumFlowers>(flowers, [&](int j)
+                                                 { stocked |= sellers[i].quantity[j].load() > 0; });
+                       return stocked; });
+    }
+
+    // Priorities and limits are fixed for the session, so the priority order
+    // and every flower's limit order are sorted once here
+    void buildEligibilityIndex()
+    {
+        std::vector<int> order(buyers.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [this](int a, int b)
+                         { return buyer_info[a].priority > buyer_info[b].priority; });
+        buyer_rank.resize(buyers.size());
+        for (int r = 0; r < order.size(); ++r)
+            buyer_rank[order[r]] = r;
+
+        eligibility.resize(flowers);
+#pragma omp parallel for
+        for (int flower = 0; flower < flowers; ++flower)
+        {
+            std::vector<int> limits(buyers.size());
+            for (int i = 0; i < buyers.size(); ++i)
+                limits[i] = buyers[i].buy_price[flower];
+            eligibility[flower].init(limits, buyer_rank, sellers.size());
+        }
+    }
+
+    void buildAskBooks()
+    {
+        int maxTick = 0;
+        for (int i = 0; i < sellers.size(); ++i)
+            for (int j = 0; j < flowers; ++j)
+                maxTick = std::max(maxTick, sellers[i].quote(j));
+
+        ask_books.resize(flowers);
+        for (int flower = 0; flower < flowers; ++flower)
+        {
+            ask_books[flower].init(sellers.size(), maxTick);
+            for (int i = 0; i < sellers.size(); ++i)
+                if (sellers[i].quantity[flower].load() > 0)
+                    ask_books[flower].insert(i, sellers[i].quote(flower));
+        }
     }
 
     void printStatus()
     {
-        std::lock_guard<std::mutex> lock(print_mutex);
+        std::lock_guard<ProfiledMutex> lock(print_mutex);
 
         std::cout << "\n"
                   << std::string(70, '=') << "\n";
         std::cout << "CURRENT MARKET STATUS (Thread Analysis)\n";
-        std::cout << "Parallel Operations: " << parallel_operations.load() << "\n";
-        std::cout << "Concurrent Trades: " << concurrent_trades.load() << "\n";
+        std::cout << "Parallel Operations: " << market_stats.read(MarketStats::ParallelOperations) << "\n";
+        std::cout << "Concurrent Trades: " << market_stats.read(MarketStats::ConcurrentTrades) << "\n";
         std::cout << std::string(70, '=') << "\n";
 
         std::cout << "\n SELLER INVENTORY:\n";
 
         // Parallel aggregation of seller statistics
-        std::vector<double> seller_revenues(sellers.size());
+        std::vector<Cents> seller_revenues(sellers.size());
         std::vector<int> seller_trade_counts(sellers.size());
 
 #pragma omp parallel for
@@ -307,24 +1844,25 @@ public:
             seller_trade_counts[i] = sellers[i].trades_count.load();
         }
 
+        std::vector<int> quotes(flowers);
         for (int i = 0; i < sellers.size(); ++i)
         {
-            std::cout << " " << sellers[i].name << " (Revenue: $" << std::fixed
-                      << std::setprecision(2) << seller_revenues[i]
+            std::cout << " " << seller_info[i].name << " (Revenue: $" << formatCents(seller_revenues[i])
                       << ", Trades: " << seller_trade_counts[i] << ")\n";
 
-            for (int j = 0; j < 3; ++j)
+            sellers[i].readQuotes(quotes.data());
+            for (int j = 0; j < flowers; ++j)
             {
-                std::cout << "   " << FlowerNames[j] << ": " << sellers[i].quantity[j].load()
-                          << "/" << sellers[i].original_quantity[j]
-                          << " @ $" << std::fixed << std::setprecision(2) << sellers[i].price[j] << "\n";
+                std::cout << "   " << catalog.name(j) << ": " << sellers[i].quantity[j].load()
+                          << "/" << seller_info[i].original_quantity[j]
+                          << " @ $" << formatCents(quotes[j]) << "\n";
             }
         }
 
         std::cout << "\n BUYER DEMANDS:\n";
 
         // Parallel aggregation of buyer statistics
-        std::vector<double> buyer_spent(buyers.size());
+        std::vector<Cents> buyer_spent(buyers.size());
         std::vector<int> buyer_purchases(buyers.size());
 
 #pragma omp parallel for
@@ -336,241 +1874,1007 @@ public:
 
         for (int i = 0; i < buyers.size(); ++i)
         {
-            std::cout << " " << buyers[i].name << " (Priority: " << buyers[i].priority
-                      << ", Spent: $" << std::fixed << std::setprecision(2) << buyer_spent[i]
+            std::cout << " " << buyer_info[i].name << " (Priority: " << buyer_info[i].priority
+                      << ", Spent: $" << formatCents(buyer_spent[i])
                       << ", Purchases: " << buyer_purchases[i] << ")\n";
 
-            for (int j = 0; j < 3; ++j)
+            for (int j = 0; j < flowers; ++j)
             {
-                if (buyers[i].original_demand[j] > 0)
+                if (buyer_info[i].original_demand[j] > 0)
                 {
-                    std::cout << "   " << FlowerNames[j] << ": " << buyers[i].demand[j].load()
-                              << "/" << buyers[i].original_demand[j]
-                              << " (max $" << buyers[i].buy_price[j] << ")\n";
+                    std::cout << "   " << catalog.name(j) << ": " << buyers[i].demand[j].load()
+                              << "/" << buyer_info[i].original_demand[j]
+                              << " (max $" << formatCents(buyers[i].buy_price[j]) << ")\n";
                 }
             }
-            std::cout << "   Budget: $" << std::fixed << std::setprecision(2)
-                      << buyers[i].budget.load() << "/$" << buyers[i].original_budget << "\n";
+            std::cout << "   Budget: $" << formatCents(buyers[i].budget.load())
+                      << "/$" << formatCents(buyer_info[i].original_budget) << "\n";
         }
         std::cout << std::endl;
     }
 
     bool allDemandsFulfilled()
     {
-        bool all_fulfilled = true;
+        return market_stats.read(MarketStats::OutstandingDemand) == 0;
+    }
 
-#pragma omp parallel for reduction(&& : all_fulfilled)
-        for (int i = 0; i < buyers.size(); ++i)
+    // Copy the fields the filters read into the column store; `order` gives the
+    // buyer at each column position
+    void loadColumns(const std::vector<int> &order)
+    {
+        columns.resizeBuyers(order.size(), flowers);
+        columns.resizeSellers(sellers.size(), flowers);
+
+#pragma omp parallel for
+        for (int p = 0; p < order.size(); ++p)
+        {
+            const Buyer &buyer = buyers[order[p]];
+            columns.id[p] = order[p];
+            columns.budget[p] = buyer.budget.load();
+            forEachFlower<NumFlowers>(flowers, [&](int flower)
+                                      {
+                                          columns.demand[flower][p] = buyer.demand[flower].load();
+                                          columns.buy_price[flower][p] = buyer.buy_price[flower]; });
+        }
+
+#pragma omp parallel
         {
-            for (int j = 0; j < 3; ++j)
+            std::vector<int> quotes(flowers);
+#pragma omp for
+            for (int i = 0; i < sellers.size(); ++i)
             {
-                if (buyers[i].demand[j].load() > 0)
-                {
-                    all_fulfilled = false;
-                }
+                sellers[i].readQuotes(quotes.data());
+                forEachFlower<NumFlowers>(flowers, [&](int flower)
+                                          {
+                                              columns.quantity[flower][i] = sellers[i].quantity[flower].load();
+                                              columns.price[flower][i] = quotes[flower]; });
             }
         }
-
-        return all_fulfilled;
     }
 
+    // One unit of matching work: the sellers of one price-ordered block of a
+    // flower's book against the buyers of one priority block. The blocks of a
+    // (flower, buyer block) pair run as a chain, each task spawning the next
+    // seller block when it finishes, so a buyer still meets cheaper sellers
+    // first; different chains run side by side on the work-stealing pool.
+    struct MatchTask
+    {
+        int flower;
+        int seller_block;
+        int buyer_block;
+    };
+
+    static const int SellerBlock = 16; // Sellers per matching task
+
     bool conductTradingRound()
     {
         std::atomic<bool> any_trade(false);
-        parallel_operations.fetch_add(1);
+        market_stats.add(MarketStats::ParallelOperations, 1);
 
         std::cout << " Conducting parallel trading round on " << omp_get_max_threads() << " threads\n";
 
-        // Sort buyers by priority (higher priority first) - parallel sort
-        std::vector<int> buyer_indices(buyers.size());
-        std::iota(buyer_indices.begin(), buyer_indices.end(), 0);
+        // Plan: walk each flower's book up to the best bid and admit the buyers
+        // the asks now reach. Only this flower's book and index are touched here.
+        std::vector<std::vector<int>> order(flowers); // Sellers to match, cheapest first
+        tunedFor("plan", flowers, [&](int flower)
+                 {
+                     EligibilityIndex &index = eligibility[flower];
+                     auto wants = [&](int b)
+                     { return buyers[b].demand[flower].load() > 0; };
+
+                     int max_bid_tick = index.maxBid(wants);
+                     if (max_bid_tick < 0)
+                         return;
+
+                     AskBook &book = ask_books[flower];
+                     for (int tick = book.bestTick(); tick >= 0 && tick <= max_bid_tick; tick = book.nextOccupied(tick + 1))
+                     {
+                         for (int seller_idx = book.head[tick]; seller_idx >= 0; seller_idx = book.next[seller_idx])
+                         {
+                             index.admit(seller_idx, tick, buyer_rank, wants);
+                             if (!index.eligible[seller_idx].empty())
+                                 order[flower].push_back(seller_idx);
+                         }
+                     } });
+
+        // Match: buyer blocks are sized for about two chains per thread and flower,
+        // so a flower that carries most of the demand still spreads over every core
+        std::string match_region = tuningRegion("match");
+        LoopTuner::Choice match_choice = tuner.choose(match_region, true);
+        WorkStealingPool<MatchTask> pool(match_choice.threads, &numa, lock_profiling ? &deque_lock : nullptr);
+        int buyer_block = std::max(1, (int)buyers.size() / (2 * pool.workers()));
+        int buyer_blocks = (buyers.size() + buyer_block - 1) / buyer_block;
+
+        // Each chain starts on a worker of the node holding its block's first
+        // buyer; idle workers steal on their own node before crossing over.
+        // The last entry of node_workers holds every worker, for blocks with no
+        // known node or no worker there.
+        std::vector<int> by_rank(buyers.size());
+        for (int b = 0; b < buyers.size(); ++b)
+            by_rank[buyer_rank[b]] = b;
+        const int any_node = numa.nodes();
+        std::vector<std::vector<int>> node_workers(any_node + 1);
+        for (int w = 0; w < pool.workers(); ++w)
+        {
+            if (numa.nodeOf(w) >= 0)
+                node_workers[numa.nodeOf(w)].push_back(w);
+            node_workers[any_node].push_back(w);
+        }
+        std::vector<int> next_worker(any_node + 1, 0);
+        for (int flower = 0; flower < flowers; ++flower)
+            if (!order[flower].empty())
+                for (int b = 0; b < buyer_blocks; ++b)
+                {
+                    int node = buyer_home[by_rank[b * buyer_block]];
+                    if (node < 0 || node_workers[node].empty())
+                        node = any_node;
+                    std::vector<int> &local = node_workers[node];
+                    pool.spawn(local[next_worker[node]++ % local.size()], {flower, 0, b});
+                }
+
+        auto match_start = std::chrono::steady_clock::now();
+        pool.run([&](const MatchTask &task, int worker)
+                 {
+                     if (matchBlock(task, order[task.flower], buyer_block))
+                         any_trade = true;
+                     if ((task.seller_block + 1) * SellerBlock < order[task.flower].size())
+                         pool.spawn(worker, {task.flower, task.seller_block + 1, task.buyer_block}); });
+        double match_round = std::chrono::duration<double>(std::chrono::steady_clock::now() - match_start).count();
+        match_seconds += match_round;
+        tuner.record(match_region, match_choice, match_round, 1.0);
+        market_stats.add(MarketStats::StolenTasks, pool.steals());
+
+        // Settle the books: delist sold-out sellers, drop satisfied buyers
+        tunedFor("books", flowers, [&](int flower)
+                 {
+                     EligibilityIndex &index = eligibility[flower];
+                     auto wants = [&](int b)
+                     { return buyers[b].demand[flower].load() > 0; };
+                     for (int seller_idx : order[flower])
+                     {
+                         if (sellers[seller_idx].quantity[flower].load() <= 0)
+                         {
+                             ask_books[flower].erase(seller_idx);
+                             index.eligible[seller_idx].clear();
+                         }
+                         else
+                         {
+                             index.prune(seller_idx, wants);
+                         }
+                     } });
 
-// Use parallel sort for better performance
-#pragma omp parallel
+        return any_trade.load();
+    }
+
+    // Run one MatchTask: each seller of the block, cheapest first, against the
+    // eligible buyers (in priority order) that fall in the task's buyer block
+    bool matchBlock(const MatchTask &task, const std::vector<int> &order, int buyer_block)
+    {
+        bool any_trade = false;
+        int flower = task.flower;
+        int node = numa.nodeOf(omp_get_thread_num());
+        int first_rank = task.buyer_block * buyer_block, last_rank = first_rank + buyer_block;
+        auto byRank = [&](int b, int rank)
+        { return buyer_rank[b] < rank; };
+
+        size_t end = std::min(order.size(), (size_t)(task.seller_block + 1) * SellerBlock);
+        for (size_t k = (size_t)task.seller_block * SellerBlock; k < end; ++k)
         {
-#pragma omp single
+            int seller_idx = order[k];
+            int price = sellers[seller_idx].quote(flower);
+            const std::vector<int> &eligible = eligibility[flower].eligible[seller_idx];
+            auto from = std::lower_bound(eligible.begin(), eligible.end(), first_rank, byRank);
+            auto to = std::lower_bound(from, eligible.end(), last_rank, byRank);
+            node_traffic.access(node, seller_home[seller_idx], sizeof(Seller));
+
+            for (auto it = from; it != to; ++it)
             {
-                std::sort(buyer_indices.begin(), buyer_indices.end(),
-                          [this](int a, int b)
-                          {
-                              return buyers[a].priority > buyers[b].priority;
-                          });
+                int buyer_idx = *it;
+                node_traffic.access(node, buyer_home[buyer_idx], sizeof(Buyer));
+                if (buyers[buyer_idx].budget.load() < price)
+                    continue;
+
+                // Calculate trade quantity (limit to prevent overselling)
+                int max_quantity = std::min({buyers[buyer_idx].demand[flower].load(),
+                                             sellers[seller_idx].quantity[flower].load() / (int)eligible.size() + 1,
+                                             static_cast<int>(buyers[buyer_idx].budget.load() / price)});
+
+                if (max_quantity > 0 && executeTrade(buyer_idx, seller_idx, flower, max_quantity))
+                    any_trade = true;
             }
         }
+        return any_trade;
+    }
 
-// Process each flower type in parallel
-#pragma omp parallel for
-        for (int flower = 0; flower < 3; ++flower)
+    // Called by every thread of a team: size the core queue matrix for the
+    // team, or just rewind it when it already fits. Each core allocates its
+    // own inboxes, so their pages are first touched on the core's node.
+    void prepareCoreQueues()
+    {
+        const int cores = omp_get_num_threads(), core = omp_get_thread_num();
+#pragma omp single
+        if (queue_cores != cores)
+        {
+            core_queues.clear();
+            core_queues.resize(cores * cores);
+            queue_cores = cores;
+        }
+        for (int from = 0; from < cores; ++from)
         {
-            // Create list of interested buyers for this flower type
-            std::vector<int> interested_buyers;
+            std::unique_ptr<SpscQueue<CoreMessage>> &inbox = core_queues[from * cores + core];
+            if (inbox)
+                inbox->reset();
+            else
+                inbox.reset(new SpscQueue<CoreMessage>());
+        }
+#pragma omp barrier
+    }
 
-            for (int buyer_idx : buyer_indices)
+    // Thread-per-core shared-nothing round. Core c owns every seller s with
+    // s % cores == c and is the home core of every buyer b with b % cores == c;
+    // only the owner ever touches an agent's state, so neither side needs a
+    // lock or a CAS. A buyer's home core escrows budget and demand for each
+    // order and routes it through an SPSC queue to the seller's core, which
+    // fills what its stock covers (a batch at a time, in buyer priority order)
+    // and sends a Fill back; the home core then returns the unfilled escrow.
+    bool conductSharedNothingRound()
+    {
+        market_stats.add(MarketStats::ParallelOperations, 1);
+
+        // Buyers route on the round's ask snapshot instead of reading stock other cores own
+        std::vector<std::vector<AskQuote>> asks = snapshotAsks();
+
+        std::atomic<int> cores_done(0);
+        std::atomic<bool> any_trade(false);
+
+#pragma omp parallel num_threads(std::max(1, omp_get_max_threads()))
+        {
+            // The runtime may hand out a smaller team than asked for (OMP_THREAD_LIMIT,
+            // OMP_DYNAMIC), so ownership and queues follow the team actually running
+            prepareCoreQueues();
+            const int cores = queue_cores;
+            std::vector<std::unique_ptr<SpscQueue<CoreMessage>>> &queue = core_queues;
+#pragma omp master
+            std::cout << " Conducting shared-nothing round on " << cores << " cores\n";
+
+            const int core = omp_get_thread_num();
+            long long awaiting = 0;         // Orders sent whose Fill has not come back
+            std::vector<CoreMessage> batch; // Orders received and not yet filled
+
+            // Buyer side: settle a Fill and release the unfilled escrow
+            auto settleFill = [&](const CoreMessage &fill)
             {
-                if (buyers[buyer_idx].demand[flower].load() > 0)
+                Buyer &buyer = buyers[fill.buyer];
+                int unfilled = fill.quantity - fill.filled;
+                buyer.budget.store(buyer.budget.load(std::memory_order_relaxed) + (Cents)unfilled * fill.price,
+                                   std::memory_order_relaxed);
+                buyer.demand[fill.flower].store(buyer.demand[fill.flower].load(std::memory_order_relaxed) + unfilled,
+                                                std::memory_order_relaxed);
+                if (fill.filled > 0)
                 {
-                    interested_buyers.push_back(buyer_idx);
+                    buyer.spent.store(buyer.spent.load(std::memory_order_relaxed) + (Cents)fill.filled * fill.price,
+                                      std::memory_order_relaxed);
+                    buyer.purchases_count.store(buyer.purchases_count.load(std::memory_order_relaxed) + 1,
+                                                std::memory_order_relaxed);
                 }
-            }
+                --awaiting;
+            };
 
-            if (interested_buyers.empty())
-                continue;
+            // Empty every inbox: Fills are settled, Orders join the batch
+            auto drain = [&]()
+            {
+                bool progress = false;
+                CoreMessage message;
+                for (int from = 0; from < cores; ++from)
+                {
+                    SpscQueue<CoreMessage> &inbox = *queue[from * cores + core];
+                    while (inbox.pop(message))
+                    {
+                        progress = true;
+                        if (message.kind == CoreMessage::Order)
+                            batch.push_back(message);
+                        else
+                            settleFill(message);
+                    }
+                }
+                return progress;
+            };
 
-            // Process sellers for this flower type
-            for (int seller_idx = 0; seller_idx < sellers.size(); ++seller_idx)
+            // Seller side: fill the batch against owned stock. A core waiting on
+            // a full queue keeps draining its own inboxes, so two cores replying
+            // to each other cannot deadlock.
+            auto fillOrders = [&]()
             {
-                if (sellers[seller_idx].quantity[flower].load() <= 0)
-                    continue;
+                std::vector<CoreMessage> orders;
+                orders.swap(batch);
+                std::sort(orders.begin(), orders.end(), [&](const CoreMessage &a, const CoreMessage &b)
+                          { return buyer_rank[a.buyer] < buyer_rank[b.buyer]; });
+                for (CoreMessage &order : orders)
+                {
+                    Seller &seller = sellers[order.seller];
+                    int stock = seller.quantity[order.flower].load(std::memory_order_relaxed);
+                    order.filled = std::min(stock, order.quantity);
+                    if (order.filled > 0)
+                    {
+                        Cents cost = (Cents)order.filled * order.price;
+                        seller.quantity[order.flower].store(stock - order.filled, std::memory_order_relaxed);
+                        seller.revenue.store(seller.revenue.load(std::memory_order_relaxed) + cost, std::memory_order_relaxed);
+                        seller.trades_count.store(seller.trades_count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                        market_stats.add(MarketStats::OutstandingDemand, -order.filled);
+                        recordFill(order.buyer, order.seller, order.flower, order.filled, order.price);
+                        any_trade = true;
+                    }
+                    order.kind = CoreMessage::Fill;
+                    SpscQueue<CoreMessage> &reply = *queue[core * cores + order.buyer % cores];
+                    while (!reply.push(order))
+                        drain();
+                }
+            };
 
-                // Find eligible buyers (can afford and want this flower)
-                std::vector<int> eligible_buyers;
-                for (int buyer_idx : interested_buyers)
+            auto serve = [&]()
+            {
+                bool progress = drain();
+                while (!batch.empty())
+                    fillOrders();
+                return progress;
+            };
+
+            // Route orders for home buyers: escrow budget and demand, then send
+            // to each crossing seller in price order until the demand is covered
+            for (int b = core; b < buyers.size(); b += cores)
+            {
+                Buyer &buyer = buyers[b];
+                for (int flower = 0; flower < flowers; ++flower)
                 {
-                    if (buyers[buyer_idx].buy_price[flower] >= sellers[seller_idx].price[flower] &&
-                        buyers[buyer_idx].budget.load() >= sellers[seller_idx].price[flower])
+                    for (const AskQuote &ask : asks[flower])
                     {
-                        eligible_buyers.push_back(buyer_idx);
+                        int demand = buyer.demand[flower].load(std::memory_order_relaxed);
+                        Cents budget = buyer.budget.load(std::memory_order_relaxed);
+                        if (demand <= 0 || ask.price > buyer.buy_price[flower])
+                            break;
+                        int units = (int)std::min<Cents>(std::min(demand, ask.stock), budget / ask.price);
+                        if (units <= 0)
+                            continue;
+
+                        buyer.demand[flower].store(demand - units, std::memory_order_relaxed);
+                        buyer.budget.store(budget - (Cents)units * ask.price, std::memory_order_relaxed);
+                        CoreMessage order = {CoreMessage::Order, b, ask.seller, flower, units, ask.price, 0};
+                        SpscQueue<CoreMessage> &out = *queue[core * cores + ask.seller % cores];
+                        while (!out.push(order))
+                            serve();
+                        ++awaiting;
                     }
                 }
+            }
 
-                if (eligible_buyers.empty())
-                    continue;
+            // Keep serving other cores until every core has its answers
+            bool done = false;
+            while (cores_done.load(std::memory_order_acquire) < cores)
+            {
+                bool progress = serve();
+                if (!done && awaiting == 0)
+                {
+                    done = true;
+                    cores_done.fetch_add(1, std::memory_order_acq_rel);
+                }
+                else if (!progress)
+                {
+                    std::this_thread::yield();
+                }
+            }
+        }
+
+        // Delist sold-out sellers; the books are only touched between rounds
+        for (int flower = 0; flower < flowers; ++flower)
+            for (const AskQuote &ask : asks[flower])
+                if (sellers[ask.seller].quantity[flower].load() <= 0 && ask_books[flower].listed(ask.seller))
+                    ask_books[flower].erase(ask.seller);
+
+        return any_trade.load();
+    }
+
+    // Deterministic intent/resolve round. Every buyer turns the round's ask
+    // snapshot into trade intents without touching shared state: cheapest
+    // crossing sellers first, each intent covered by the budget the buyer's
+    // earlier intents left. Intents are then sorted in parallel by (seller,
+    // flower, priority rank, buyer id), a unique key, and a prefix sum over
+    // each (seller, flower) run tells every intent how much of the stock is
+    // left when its turn comes. Neither step depends on the thread count, so
+    // the fills, and the market state after them, are bit-identical at any
+    // number of threads.
+    bool conductDeterministicRound()
+    {
+        market_stats.add(MarketStats::ParallelOperations, 1);
+
+        std::cout << " Conducting deterministic round on " << omp_get_max_threads() << " threads\n";
+
+        struct TradeIntent
+        {
+            int seller, flower, rank, buyer, quantity, price;
+        };
+
+        // Intent: each thread reads only the snapshot and its own buyers
+        std::vector<std::vector<AskQuote>> asks = snapshotAsks();
+        std::vector<std::vector<TradeIntent>> per_thread(omp_get_max_threads());
+        tunedFor("intents", active_buyers.size(), [&](int a)
+                 {
+                     std::vector<TradeIntent> &mine = per_thread[omp_get_thread_num()];
+                     int b = active_buyers[a];
+                     Cents budget = buyers[b].budget.load();
+                     for (int flower = 0; flower < flowers; ++flower)
+                     {
+                         int demand = buyers[b].demand[flower].load();
+                         for (const AskQuote &ask : asks[flower])
+                         {
+                             if (demand <= 0 || ask.price > buyers[b].buy_price[flower])
+                                 break;
+                             int units = (int)std::min<Cents>(std::min(demand, ask.stock), budget / ask.price);
+                             if (units <= 0)
+                                 continue;
+                             mine.push_back({ask.seller, flower, buyer_rank[b], b, units, ask.price});
+                             demand -= units;
+                             budget -= (Cents)units * ask.price;
+                         }
+                     } });
+        std::vector<TradeIntent> intents;
+        for (const std::vector<TradeIntent> &mine : per_thread)
+            intents.insert(intents.end(), mine.begin(), mine.end());
+        if (intents.empty())
+            return false;
+
+        // Resolve: order competing intents, then give out each seller's stock
+        // along the order with a prefix sum over the requested quantities
+        __gnu_parallel::sort(intents.begin(), intents.end(), [](const TradeIntent &x, const TradeIntent &y)
+                             { return std::tie(x.seller, x.flower, x.rank, x.buyer) <
+                                      std::tie(y.seller, y.flower, y.rank, y.buyer); });
+        const int n = intents.size();
+        std::vector<long long> requested(n), before(n);
+#pragma omp parallel for
+        for (int i = 0; i < n; ++i)
+            requested[i] = intents[i].quantity;
+        __gnu_parallel::partial_sum(requested.begin(), requested.end(), before.begin());
+
+        // Start of each intent's (seller, flower) run
+        std::vector<int> heads(n);
+        std::iota(heads.begin(), heads.end(), 0);
+        compactIds(heads, [&](int i)
+                   { return i == 0 || intents[i].seller != intents[i - 1].seller ||
+                            intents[i].flower != intents[i - 1].flower; });
+
+        std::vector<int> filled(n);
+#pragma omp parallel for
+        for (int i = 0; i < n; ++i)
+        {
+            const TradeIntent &intent = intents[i];
+            int head = *(std::upper_bound(heads.begin(), heads.end(), i) - 1);
+            long long ahead = before[i] - requested[i] - (before[head] - requested[head]);
+            long long left = sellers[intent.seller].quantity[intent.flower].load() - ahead;
+            filled[i] = (int)std::max(0LL, std::min<long long>(left, intent.quantity));
+        }
+
+        // Apply: the updates are sums, so their order does not matter
+#pragma omp parallel for
+        for (int i = 0; i < n; ++i)
+        {
+            if (filled[i] <= 0)
+                continue;
+            const TradeIntent &intent = intents[i];
+            Buyer &buyer = buyers[intent.buyer];
+            Seller &seller = sellers[intent.seller];
+            Cents cost = (Cents)filled[i] * intent.price;
+            buyer.demand[intent.flower].fetch_sub(filled[i]);
+            buyer.subtractBudget(cost);
+            buyer.addSpent(cost);
+            buyer.purchases_count.fetch_add(1);
+            seller.quantity[intent.flower].fetch_sub(filled[i]);
+            seller.addRevenue(cost);
+            seller.trades_count.fetch_add(1);
+        }
+
+        // Log and journal in resolve order, so those come out identical too
+        bool any_trade = false;
+        for (int i = 0; i < n; ++i)
+        {
+            if (filled[i] <= 0)
+                continue;
+            const TradeIntent &intent = intents[i];
+            market_stats.add(MarketStats::OutstandingDemand, -filled[i]);
+            recordFill(intent.buyer, intent.seller, intent.flower, filled[i], intent.price);
+            any_trade = true;
+        }
+
+        for (int flower = 0; flower < flowers; ++flower)
+            for (const AskQuote &ask : asks[flower])
+                if (sellers[ask.seller].quantity[flower].load() <= 0 && ask_books[flower].listed(ask.seller))
+                    ask_books[flower].erase(ask.seller);
+
+        return any_trade;
+    }
+
+    // One resting ask as of the start of a round
+    struct AskQuote
+    {
+        int seller, price, stock;
+    };
+
+    // Every flower's listed asks, cheapest first (earliest listed first within a tick)
+    std::vector<std::vector<AskQuote>> snapshotAsks()
+    {
+        std::vector<std::vector<AskQuote>> asks(flowers);
+#pragma omp parallel for
+        for (int flower = 0; flower < flowers; ++flower)
+        {
+            AskBook &book = ask_books[flower];
+            for (int tick = book.bestTick(); tick >= 0; tick = book.nextOccupied(tick + 1))
+                for (int s = book.head[tick]; s >= 0; s = book.next[s])
+                    asks[flower].push_back({s, sellers[s].quote(flower), sellers[s].quantity[flower].load()});
+        }
+        return asks;
+    }
+
+    // Uniform-price call auction. Per flower, bids are sorted in parallel by limit
+    // (then buyer priority), asks are taken cheapest-first from the ask book, and
+    // prefix sums of both sides give demand and supply at every candidate tick.
+    // The flower clears at the single price that maximises matched volume.
+    bool conductCallAuctionRound()
+    {
+        bool any_trade = false;
+        market_stats.add(MarketStats::ParallelOperations, 1);
+
+        std::cout << " Conducting call auction round on " << omp_get_max_threads() << " threads\n";
+
+        // Flowers are cleared one after another so every stage below can use all threads
+        for (int flower = 0; flower < flowers; ++flower)
+        {
+            // Demand side, capped by what each budget covers at the buyer's own limit
+            std::vector<AuctionOrder> bids(active_buyers.size());
 
-// Parallel trade execution for eligible buyers
 #pragma omp parallel for
-                for (int i = 0; i < eligible_buyers.size(); ++i)
+            for (int a = 0; a < active_buyers.size(); ++a)
+            {
+                int i = active_buyers[a];
+                int demand = buyers[i].demand[flower].load();
+                int limit = buyers[i].buy_price[flower];
+                int quantity = limit > 0 ? (int)std::min<Cents>(demand, buyers[i].budget.load() / limit) : 0;
+                bids[a] = {limit, quantity, i, buyer_info[i].priority};
+            }
+
+            bids.erase(std::remove_if(bids.begin(), bids.end(),
+                                      [](const AuctionOrder &o)
+                                      { return o.quantity <= 0; }),
+                       bids.end());
+            __gnu_parallel::sort(bids.begin(), bids.end(),
+                                 [](const AuctionOrder &a, const AuctionOrder &b)
+                                 {
+                                     if (a.tick != b.tick)
+                                         return a.tick > b.tick;
+                                     if (a.priority != b.priority)
+                                         return a.priority > b.priority;
+                                     return a.agent < b.agent;
+                                 });
+
+            // Supply side, already in price-time order in the ask book
+            std::vector<AuctionOrder> asks;
+            AskBook &book = ask_books[flower];
+            for (int tick = book.bestTick(); tick >= 0; tick = book.nextOccupied(tick + 1))
+            {
+                for (int seller_idx = book.head[tick]; seller_idx >= 0; seller_idx = book.next[seller_idx])
+                {
+                    asks.push_back({tick, sellers[seller_idx].quantity[flower].load(), seller_idx, 0});
+                }
+            }
+
+            if (bids.empty() || asks.empty() || asks.front().tick > bids.front().tick)
+                continue;
+
+            std::vector<long long> bid_cum(bids.size()), ask_cum(asks.size());
+            for (int i = 0; i < bids.size(); ++i)
+                bid_cum[i] = (i > 0 ? bid_cum[i - 1] : 0) + bids[i].quantity;
+            for (int j = 0; j < asks.size(); ++j)
+                ask_cum[j] = (j > 0 ? ask_cum[j - 1] : 0) + asks[j].quantity;
+
+            // Matched volume at tick p: demand from bids at or above p against supply from asks at or below p
+            auto demandAt = [&](int p) -> long long
+            {
+                auto it = std::partition_point(bids.begin(), bids.end(),
+                                               [p](const AuctionOrder &o)
+                                               { return o.tick >= p; });
+                return it == bids.begin() ? 0 : bid_cum[it - bids.begin() - 1];
+            };
+            auto supplyAt = [&](int p) -> long long
+            {
+                auto it = std::partition_point(asks.begin(), asks.end(),
+                                               [p](const AuctionOrder &o)
+                                               { return o.tick <= p; });
+                return it == asks.begin() ? 0 : ask_cum[it - asks.begin() - 1];
+            };
+
+            // Candidate prices are all quoted ticks: maximise volume, then minimise
+            // imbalance, then take the middle of whatever range of ticks is left
+            int candidates = bids.size() + asks.size();
+            auto candidateTick = [&](int c)
+            { return c < (int)bids.size() ? bids[c].tick : asks[c - bids.size()].tick; };
+
+            long long best_volume = 0;
+#pragma omp parallel for reduction(max : best_volume)
+            for (int c = 0; c < candidates; ++c)
+            {
+                int p = candidateTick(c);
+                best_volume = std::max(best_volume, std::min(demandAt(p), supplyAt(p)));
+            }
+
+            if (best_volume <= 0)
+                continue;
+
+            long long best_imbalance = LLONG_MAX;
+#pragma omp parallel for reduction(min : best_imbalance)
+            for (int c = 0; c < candidates; ++c)
+            {
+                int p = candidateTick(c);
+                long long d = demandAt(p), s = supplyAt(p);
+                if (std::min(d, s) == best_volume)
+                    best_imbalance = std::min(best_imbalance, std::llabs(d - s));
+            }
+
+            int lo_tick = INT_MAX, hi_tick = INT_MIN;
+#pragma omp parallel for reduction(min : lo_tick) reduction(max : hi_tick)
+            for (int c = 0; c < candidates; ++c)
+            {
+                int p = candidateTick(c);
+                long long d = demandAt(p), s = supplyAt(p);
+                if (std::min(d, s) == best_volume && std::llabs(d - s) == best_imbalance)
                 {
-                    int buyer_idx = eligible_buyers[i];
+                    lo_tick = std::min(lo_tick, p);
+                    hi_tick = std::max(hi_tick, p);
+                }
+            }
+
+            int clearing_tick = (lo_tick + hi_tick) / 2;
+            long long volume = std::min(demandAt(clearing_tick), supplyAt(clearing_tick));
 
-                    // Calculate trade quantity (limit to prevent overselling)
-                    int max_quantity = std::min({buyers[buyer_idx].demand[flower].load(),
-                                                 sellers[seller_idx].quantity[flower].load() / (int)eligible_buyers.size() + 1,
-                                                 static_cast<int>(buyers[buyer_idx].budget.load() / sellers[seller_idx].price[flower])});
+            // Allocation: bid i owns volume [bid_cum[i-1], bid_cum[i]) and ask j owns
+            // [ask_cum[j-1], ask_cum[j]), so overlapping ranges become fills
+            std::atomic<int> filled(0);
+
+#pragma omp parallel for
+            for (int i = 0; i < bids.size(); ++i)
+            {
+                long long start = i > 0 ? bid_cum[i - 1] : 0;
+                long long end = std::min(bid_cum[i], volume);
+                if (start >= end)
+                    continue;
 
-                    if (max_quantity > 0)
+                int j = std::upper_bound(ask_cum.begin(), ask_cum.end(), start) - ask_cum.begin();
+                while (start < end && j < asks.size())
+                {
+                    int take = std::min(end, ask_cum[j]) - start;
+                    if (executeTrade(bids[i].agent, asks[j].agent, flower, take, clearing_tick))
                     {
-                        if (executeTrade(buyer_idx, seller_idx, flower, max_quantity))
-                        {
-                            any_trade = true;
-                        }
+                        filled.fetch_add(take);
                     }
+                    start += take;
+                    ++j;
                 }
             }
+
+            for (const AuctionOrder &ask : asks)
+            {
+                if (sellers[ask.agent].quantity[flower].load() <= 0)
+                    book.erase(ask.agent);
+            }
+
+            if (filled.load() > 0)
+            {
+                any_trade = true;
+            }
+
+            logger.log(LOG_INFO, ClearedEvent, flower, clearing_tick, volume);
+        }
+
+        return any_trade;
+    }
+
+    bool executeTrade(int buyer_idx, int seller_idx, int flower, int quantity)
+    {
+        return executeTrade(buyer_idx, seller_idx, flower, quantity, sellers[seller_idx].quote(flower));
+    }
+
+    // Settle a fill at an explicit unit price in ticks (the call auction clears at one price per flower)
+    bool executeTrade(int buyer_idx, int seller_idx, int flower, int quantity, int price)
+    {
+        int actual_quantity = settle(buyer_idx, seller_idx, flower, quantity, price);
+        if (actual_quantity <= 0)
+            return false;
+
+        recordFill(buyer_idx, seller_idx, flower, actual_quantity, price);
+        return true;
+    }
+
+    // Count, log and journal a settled fill
+    void recordFill(int buyer_idx, int seller_idx, int flower, int actual_quantity, int price)
+    {
+        Cents cost = (Cents)actual_quantity * price;
+
+        // Update global statistics
+        market_stats.add(MarketStats::Trades, 1);
+        market_stats.add(MarketStats::Volume, cost);
+        market_stats.add(MarketStats::ConcurrentTrades, 1);
+
+        // Print trade info with thread information
+        logger.log(LOG_TRADES, FillEvent, buyer_idx, seller_idx, flower, actual_quantity, price);
+
+        // Record trade
+        journal.record({std::chrono::duration_cast<std::chrono::nanoseconds>(
+                            std::chrono::steady_clock::now().time_since_epoch())
+                            .count(),
+                        cost,
+                        buyer_idx,
+                        seller_idx,
+                        flower,
+                        actual_quantity,
+                        price,
+                        omp_get_thread_num()});
+    }
+
+    // Lock-free settlement. Demand, budget and stock are reserved in that order,
+    // each with a CAS that takes as much as is left up to the running quantity;
+    // whatever a later step cannot cover is handed back to the earlier ones, so
+    // a fill never overdraws and a failed fill leaves no trace. Returns the
+    // units settled.
+    int settle(int buyer_idx, int seller_idx, int flower, int quantity, int price)
+    {
+        Buyer &buyer = buyers[buyer_idx];
+
+        int wanted = reserveUnits(buyer.demand[flower], quantity);
+        if (wanted <= 0)
+            return 0;
+
+        int paid = buyer.reserveBudget(wanted, price);
+        if (paid < wanted)
+            buyer.demand[flower].fetch_add(wanted - paid);
+        if (paid <= 0)
+            return 0;
+
+        int got = sellStock(buyer_idx, seller_idx, flower, paid, price);
+        if (got < paid)
+        {
+            buyer.budget.fetch_add((Cents)(paid - got) * price);
+            buyer.demand[flower].fetch_add(paid - got);
         }
+        if (got <= 0)
+            return 0;
 
-        return any_trade.load();
+        Cents cost = (Cents)got * price;
+        buyer.addSpent(cost);
+        buyer.purchases_count.fetch_add(1);
+        market_stats.add(MarketStats::OutstandingDemand, -got);
+        return got;
     }
 
-    bool executeTrade(int buyer_idx, int seller_idx, int flower, int quantity)
+    // Seller side of a fill: take up to `units` from stock and book the revenue.
+    // Failed CAS attempts are counted towards making the seller hot; a hot
+    // seller's fills are published to its FlatCombiner instead.
+    int sellStock(int buyer_idx, int seller_idx, int flower, int units, int price)
     {
-        // Use seller and buyer locks for thread safety
-        omp_set_lock(&buyers[buyer_idx].lock);
-        omp_set_lock(&sellers[seller_idx].lock);
-
-        Buyer &buyer = buyers[buyer_idx];
         Seller &seller = sellers[seller_idx];
+        if (seller.combining.load(std::memory_order_relaxed))
+        {
+            int rank = buyer_rank.empty() ? buyer_idx : buyer_rank[buyer_idx];
+            int got = combine(seller_idx, flower, units, price, rank);
+            if (got >= 0)
+                return got;
+        }
 
-        // Double-check availability and affordability
-        int buyer_demand = buyer.demand[flower].load();
-        int seller_stock = seller.quantity[flower].load();
-        double buyer_budget = buyer.budget.load();
+        int retries = 0;
+        int got = reserveUnits(seller.quantity[flower], units, &retries);
+        if (retries > 0)
+        {
+            seller.contention.fetch_add(retries, std::memory_order_relaxed);
+            if (lock_profiling)
+                seller_locks[seller_idx].retries.fetch_add(retries, std::memory_order_relaxed);
+        }
+        if (got > 0)
+        {
+            seller.addRevenue((Cents)got * price);
+            seller.trades_count.fetch_add(1);
+        }
+        return got;
+    }
 
-        if (buyer_demand <= 0 || seller_stock <= 0 || quantity <= 0)
+    // Publish a request to the seller's combiner and wait until some combiner,
+    // possibly this thread, has applied it. Returns the units sold, or -1 when
+    // this thread's slot is taken (more threads than slots) and the caller
+    // should settle directly.
+    int combine(int seller_idx, int flower, int units, int price, int rank)
+    {
+        FlatCombiner &combiner = *combiners[seller_idx];
+        FlatCombiner::Slot &mine = combiner.slot[omp_get_thread_num() % FlatCombiner::Slots];
+        int idle = FlatCombiner::Idle;
+        if (!mine.state.compare_exchange_strong(idle, FlatCombiner::Claimed, std::memory_order_acquire))
+            return -1;
+
+        mine.flower = flower;
+        mine.quantity = units;
+        mine.price = price;
+        mine.rank = rank;
+        mine.state.store(FlatCombiner::Pending, std::memory_order_release);
+        combiner.requests.fetch_add(1, std::memory_order_relaxed);
+        long long published = lock_profiling ? LockProfile::now() : 0;
+
+        while (mine.state.load(std::memory_order_acquire) == FlatCombiner::Pending)
         {
-            omp_unset_lock(&sellers[seller_idx].lock);
-            omp_unset_lock(&buyers[buyer_idx].lock);
-            return false;
+            if (!combiner.busy.load(std::memory_order_relaxed) &&
+                !combiner.busy.exchange(true, std::memory_order_acquire))
+            {
+                applyCombined(seller_idx, combiner);
+                combiner.busy.store(false, std::memory_order_release);
+            }
+            else
+            {
+                std::this_thread::yield();
+            }
         }
 
-        // Calculate actual trade quantity
-        int affordable = static_cast<int>(buyer_budget / seller.price[flower]);
-        int actual_quantity = std::min({affordable, buyer_demand, seller_stock, quantity});
+        // A combined fill waited on the seller just as a locked one would
+        if (lock_profiling)
+            seller_locks[seller_idx].acquired(LockProfile::now() - published, true);
 
-        if (actual_quantity <= 0)
+        int got = mine.granted;
+        mine.state.store(FlatCombiner::Idle, std::memory_order_release);
+        return got;
+    }
+
+    // Combiner pass: apply every pending request to the seller in buyer
+    // priority order, then book the batch's revenue with one update
+    void applyCombined(int seller_idx, FlatCombiner &combiner)
+    {
+        Seller &seller = sellers[seller_idx];
+        int pending[FlatCombiner::Slots];
+        int count = 0;
+        for (int k = 0; k < FlatCombiner::Slots; ++k)
+            if (combiner.slot[k].state.load(std::memory_order_acquire) == FlatCombiner::Pending)
+                pending[count++] = k;
+        std::sort(pending, pending + count, [&](int a, int b)
+                  { return combiner.slot[a].rank < combiner.slot[b].rank; });
+
+        Cents revenue = 0;
+        int fills = 0;
+        for (int k = 0; k < count; ++k)
         {
-            omp_unset_lock(&sellers[seller_idx].lock);
-            omp_unset_lock(&buyers[buyer_idx].lock);
-            return false;
+            FlatCombiner::Slot &request = combiner.slot[pending[k]];
+            // Direct settlers may still be draining the same stock, so take it with the CAS
+            int got = reserveUnits(seller.quantity[request.flower], request.quantity);
+            revenue += (Cents)got * request.price;
+            fills += got > 0;
+            request.granted = got;
+        }
+        if (fills > 0)
+        {
+            seller.addRevenue(revenue);
+            seller.trades_count.fetch_add(fills);
+            market_stats.add(MarketStats::CombinedFills, fills);
         }
+        combiner.batches.fetch_add(1, std::memory_order_relaxed);
+
+        for (int k = 0; k < count; ++k)
+            combiner.slot[pending[k]].state.store(FlatCombiner::Done, std::memory_order_release);
+    }
+
+    // The previous settlement under the buyer then seller omp_lock_t; kept as
+    // the baseline for runSettlementBenchmark
+    int settleLocked(int buyer_idx, int seller_idx, int flower, int quantity, int price)
+    {
+        Buyer &buyer = buyers[buyer_idx];
+        Seller &seller = sellers[seller_idx];
 
-        double cost = actual_quantity * seller.price[flower];
+        buyer_mutexes[buyer_idx].set();
+        seller_mutexes[seller_idx].set();
 
-        // Execute atomic updates - using helper methods for doubles
-        buyer.demand[flower].fetch_sub(actual_quantity);
-        if (!buyer.subtractBudget(cost))
+        int affordable = (int)std::min<Cents>(INT_MAX, buyer.budget.load() / price);
+        int actual_quantity = std::min({affordable, buyer.demand[flower].load(), seller.quantity[flower].load(), quantity});
+
+        if (actual_quantity > 0)
         {
-            // Budget insufficient, rollback
-            buyer.demand[flower].fetch_add(actual_quantity);
-            omp_unset_lock(&sellers[seller_idx].lock);
-            omp_unset_lock(&buyers[buyer_idx].lock);
-            return false;
+            Cents cost = (Cents)actual_quantity * price;
+            buyer.demand[flower].fetch_sub(actual_quantity);
+            buyer.subtractBudget(cost);
+            buyer.addSpent(cost);
+            buyer.purchases_count.fetch_add(1);
+
+            seller.quantity[flower].fetch_sub(actual_quantity);
+            seller.addRevenue(cost);
+            seller.trades_count.fetch_add(1);
+            market_stats.add(MarketStats::OutstandingDemand, -actual_quantity);
         }
-        buyer.addSpent(cost);
-        buyer.purchases_count.fetch_add(1);
 
-        seller.quantity[flower].fetch_sub(actual_quantity);
-        seller.addRevenue(cost);
-        seller.trades_count.fetch_add(1);
+        seller_mutexes[seller_idx].unset();
+        buyer_mutexes[buyer_idx].unset();
+        return std::max(0, actual_quantity);
+    }
 
-        // Update global statistics
-        total_trades.fetch_add(1);
-        addToTotalVolume(cost);
-        concurrent_trades.fetch_add(1);
+    // One step of the price-drop schedule: 25 ticks down, floored at 30
+    static int droppedPrice(int price)
+    {
+        return price > PRICE_FLOOR ? std::max(PRICE_FLOOR, price - PRICE_DROP) : price;
+    }
 
-        // Record trade
-        TradeRecord record = {
-            buyer.name,
-            seller.name,
-            flower,
-            actual_quantity,
-            seller.price[flower],
-            cost,
-            getCurrentTimestamp(),
-            omp_get_thread_num()};
+    // Apply `steps` rounds of price drops at once (used to skip idle rounds)
+    void dropPrices(int steps = 1)
+    {
+        std::cout << "Parallel price adjustment across all sellers...\n";
 
+        // One quote update per seller, so readers see all of its flowers drop together
+#pragma omp parallel for
+        for (int a = 0; a < active_sellers.size(); ++a)
         {
-            std::lock_guard<std::mutex> lock(history_mutex);
-            trade_history.push_back(record);
+            sellers[active_sellers[a]].publishQuotes([&](FlowerSlots<std::atomic<int>, NumFlowers> &quotes)
+                                                     {
+                                                         for (int flower = 0; flower < flowers; ++flower)
+                                                         {
+                                                             int tick = quotes[flower].load(std::memory_order_relaxed);
+                                                             for (int step = 0; step < steps && tick > PRICE_FLOOR; ++step)
+                                                                 tick = droppedPrice(tick);
+                                                             quotes[flower].store(tick, std::memory_order_relaxed);
+                                                         } });
         }
 
-        // Print trade info with thread information
+        // Relink repriced sellers; each flower's book is updated by one thread
+#pragma omp parallel for
+        for (int flower = 0; flower < flowers; ++flower)
         {
-            std::lock_guard<std::mutex> lock(print_mutex);
-            std::cout << " [T" << omp_get_thread_num() << "] " << buyer.name
-                      << " bought " << actual_quantity << " " << FlowerNames[flower]
-                      << "(s) from " << seller.name << " for $" << std::fixed
-                      << std::setprecision(2) << cost << " ($" << seller.price[flower] << " each)\n";
+            for (int i : active_sellers)
+                ask_books[flower].reprice(i, sellers[i].quote(flower));
         }
 
-        omp_unset_lock(&sellers[seller_idx].lock);
-        omp_unset_lock(&buyers[buyer_idx].lock);
-
-        return true;
+        market_stats.add(MarketStats::ParallelOperations, 1);
     }
 
-    void dropPrices()
+    // Number of price drops until some ask with stock meets a buyer who still
+    // wants that flower and can afford one unit, or -1 if every ask hits the
+    // price floor first. Prices fall in lockstep, so the lowest ask (the best
+    // tick bucket of the ask book) is the first one that can cross.
+    int dropsUntilCrossing()
     {
-        std::cout << "Parallel price adjustment across all sellers...\n";
+        int drops = -1;
 
-#pragma omp parallel for collapse(2)
-        for (int i = 0; i < sellers.size(); ++i)
+        for (int flower = 0; flower < flowers; ++flower)
         {
-            for (int flower = 0; flower < 3; ++flower)
+            AskBook &book = ask_books[flower];
+            if (book.empty())
+                continue;
+
+            int ask = book.bestTick();
+
+            // Highest price any interested buyer would pay for one unit
+            Cents bid = -1;
+#pragma omp parallel for reduction(max : bid)
+            for (int a = 0; a < active_buyers.size(); ++a)
             {
-                if (sellers[i].price[flower] > 0.3)
-                {
-                    sellers[i].price[flower] = std::max(0.3, sellers[i].price[flower] - 0.25);
-                }
+                int i = active_buyers[a];
+                if (buyers[i].demand[flower].load() > 0)
+                    bid = std::max(bid, std::min<Cents>(buyers[i].buy_price[flower], buyers[i].budget.load()));
+            }
+
+            // Step the schedule exactly as dropPrices would
+            int steps = 0;
+            while (ask > bid && ask > PRICE_FLOOR)
+            {
+                ask = droppedPrice(ask);
+                steps++;
             }
+
+            if (ask <= bid && (drops < 0 || steps < drops))
+                drops = steps;
         }
 
-        parallel_operations.fetch_add(1);
+        return drops;
     }
 
     void runMarket()
     {
         bool market_open = true;
         int round = 0;
+        const int max_rounds = 30;
 
         std::cout << " PARALLEL FLOWER MARKET OPENING \n";
         std::cout << "Market has " << sellers.size() << " sellers and " << buyers.size() << " buyers\n";
@@ -581,11 +2885,26 @@ public:
             round++;
             std::cout << "\n--- ROUND " << round << " ---\n";
 
-            bool any_trade = conductTradingRound();
+            bool any_trade = call_auction     ? conductCallAuctionRound()
+                             : shared_nothing ? conductSharedNothingRound()
+                             : deterministic  ? conductDeterministicRound()
+                                              : conductTradingRound();
+            logger.flush(); // The round's fills print before anything that follows
+            coolSellers();
+            if (any_trade)
+                compactActive();
 
             if (!any_trade)
             {
-                dropPrices();
+                // Rounds before the next bid/ask crossing cannot trade, so apply
+                // all of their price drops now (without running past the timeout)
+                int drops = std::min(std::max(1, dropsUntilCrossing()), max_rounds + 1 - round);
+                if (drops > 1)
+                {
+                    std::cout << " Fast-forwarding " << drops - 1 << " idle round(s)\n";
+                    round += drops - 1;
+                }
+                dropPrices(drops);
 
                 // Parallel market analysis
                 analyzeMarketConditions();
@@ -601,17 +2920,153 @@ public:
                 std::cout << " All buyers' demands fulfilled! Market closing.\n";
                 market_open = false;
             }
+            else if (dropsUntilCrossing() < 0)
+            {
+                std::cout << " No remaining bid can ever meet an ask. Market stalled, closing.\n";
+                market_open = false;
+            }
 
             // Enhanced exit condition
-            if (round > 30)
+            if (market_open && round > max_rounds)
             {
-                std::cout << " Market timeout after 30 rounds.\n";
+                std::cout << " Market timeout after " << max_rounds << " rounds.\n";
                 market_open = false;
             }
 
             std::this_thread::sleep_for(std::chrono::milliseconds(300));
         }
 
+        logger.stop();
+        journal.stop();
+        tuner.save();
+        printFinalReport();
+    }
+
+    // Continuous double auction: buyer limits rest as bids, seller prices rest as
+    // asks, and every arrival is matched immediately with price-time priority.
+    // Fills execute at the ask through executeTrade, as in the round-based engine.
+    // Each flower has its own pair of books and is matched by one thread.
+    void runContinuousMarket()
+    {
+        std::cout << " CONTINUOUS FLOWER MARKET OPENING \n";
+        std::cout << "Market has " << sellers.size() << " sellers and " << buyers.size() << " buyers\n";
+        std::cout << "Running on " << omp_get_max_threads() << " threads\n";
+
+        // Agents arrive in a fixed pseudo-random order: ids below sellers.size()
+        // are sellers, the rest are buyers
+        std::vector<int> arrivals(sellers.size() + buyers.size());
+        std::iota(arrivals.begin(), arrivals.end(), 0);
+        std::shuffle(arrivals.begin(), arrivals.end(), std::mt19937(7));
+
+        int maxTick = 0;
+        for (int i = 0; i < sellers.size(); ++i)
+            for (int j = 0; j < flowers; ++j)
+                maxTick = std::max(maxTick, sellers[i].quote(j));
+        for (int i = 0; i < buyers.size(); ++i)
+            for (int j = 0; j < flowers; ++j)
+                maxTick = std::max(maxTick, buyers[i].buy_price[j]);
+
+        std::vector<double> fill_us_sum(flowers, 0.0), fill_us_max(flowers, 0.0);
+        std::vector<int> fills(flowers, 0);
+        auto market_start = std::chrono::steady_clock::now();
+
+#pragma omp parallel for
+        for (int flower = 0; flower < flowers; ++flower)
+        {
+            // Bids reuse AskBook with mirrored ticks so the best (highest) bid
+            // sits at the lowest key
+            AskBook asks, bids;
+            asks.init(sellers.size(), maxTick);
+            bids.init(buyers.size(), maxTick);
+            std::vector<std::chrono::steady_clock::time_point> bid_time(buyers.size());
+
+            auto matchCrossed = [&]()
+            {
+                while (!asks.empty() && !bids.empty() && asks.bestTick() <= maxTick - bids.bestTick())
+                {
+                    int seller_idx = asks.bestSeller();
+                    int buyer_idx = bids.bestSeller();
+
+                    if (executeTrade(buyer_idx, seller_idx, flower, buyers[buyer_idx].demand[flower].load()))
+                    {
+                        double us = std::chrono::duration<double, std::micro>(
+                                        std::chrono::steady_clock::now() - bid_time[buyer_idx])
+                                        .count();
+                        fill_us_sum[flower] += us;
+                        fill_us_max[flower] = std::max(fill_us_max[flower], us);
+                        fills[flower]++;
+                    }
+                    else
+                    {
+                        // Budget can no longer cover a single unit at this ask
+                        bids.erase(buyer_idx);
+                    }
+
+                    if (sellers[seller_idx].quantity[flower].load() <= 0)
+                        asks.erase(seller_idx);
+                    if (bids.listed(buyer_idx) && buyers[buyer_idx].demand[flower].load() <= 0)
+                        bids.erase(buyer_idx);
+                }
+            };
+
+            for (int id : arrivals)
+            {
+                if (id < (int)sellers.size())
+                {
+                    if (sellers[id].quantity[flower].load() > 0)
+                        asks.insert(id, sellers[id].quote(flower));
+                }
+                else
+                {
+                    int buyer_idx = id - sellers.size();
+                    if (buyers[buyer_idx].demand[flower].load() > 0)
+                    {
+                        bid_time[buyer_idx] = std::chrono::steady_clock::now();
+                        bids.insert(buyer_idx, maxTick - buyers[buyer_idx].buy_price[flower]);
+                    }
+                }
+                matchCrossed();
+            }
+
+            // Once everyone has arrived, unfilled sellers amend their asks down
+            // the usual price-drop schedule; each amendment re-enters the book
+            // at the back of its new tick and is matched straight away
+            while (!asks.empty() && !bids.empty())
+            {
+                bool amended = false;
+                for (int i = 0; i < sellers.size(); ++i)
+                {
+                    if (asks.listed(i) && sellers[i].quote(flower) > PRICE_FLOOR)
+                    {
+                        sellers[i].setQuote(flower, droppedPrice(sellers[i].quote(flower)));
+                        asks.reprice(i, sellers[i].quote(flower));
+                        amended = true;
+                    }
+                }
+                if (!amended)
+                    break;
+                matchCrossed();
+            }
+        }
+
+        double elapsed_ms = std::chrono::duration<double, std::milli>(
+                                std::chrono::steady_clock::now() - market_start)
+                                .count();
+
+        logger.flush();
+        std::cout << "\n CONTINUOUS MATCHING LATENCY:\n";
+        for (int flower = 0; flower < flowers; ++flower)
+        {
+            std::cout << "   " << catalog.name(flower) << ": " << fills[flower] << " fills, avg time-to-fill "
+                      << std::fixed << std::setprecision(1)
+                      << (fills[flower] > 0 ? fill_us_sum[flower] / fills[flower] : 0.0)
+                      << " us, max " << fill_us_max[flower] << " us\n";
+        }
+        std::cout << "Market session: " << std::setprecision(2) << elapsed_ms << " ms\n";
+
+        logger.stop();
+        journal.stop();
+        tuner.save();
         printFinalReport();
     }
 
@@ -619,44 +3074,49 @@ public:
     {
         std::cout << " Parallel market analysis...\n";
 
-        // Parallel calculation of market metrics
-        std::vector<double> avg_prices(3, 0.0);
-        std::vector<int> total_supply(3, 0);
-        std::vector<int> total_demand(3, 0);
+        // Parallel calculation of market metrics over a fresh column snapshot
+        std::vector<double> avg_prices(flowers, 0.0);
+        std::vector<int> total_supply(flowers, 0);
+        std::vector<int> total_demand(flowers, 0);
+
+        // Buyers without demand add nothing to it, so only active ones are loaded
+        loadColumns(active_buyers);
 
 #pragma omp parallel for
-        for (int flower = 0; flower < 3; ++flower)
+        for (int flower = 0; flower < flowers; ++flower)
         {
-            double price_sum = 0.0;
+            long long price_sum = 0;
             int supply_sum = 0;
             int demand_sum = 0;
             int seller_count = 0;
 
+            const int *quantity = columns.quantity[flower].data();
+            const int *price = columns.price[flower].data();
+#pragma omp simd reduction(+ : price_sum, supply_sum, seller_count)
             for (int i = 0; i < sellers.size(); ++i)
             {
-                if (sellers[i].quantity[flower].load() > 0)
-                {
-                    price_sum += sellers[i].price[flower];
-                    seller_count++;
-                }
-                supply_sum += sellers[i].quantity[flower].load();
+                price_sum += quantity[i] > 0 ? price[i] : 0;
+                seller_count += quantity[i] > 0;
+                supply_sum += quantity[i];
             }
 
-            for (int i = 0; i < buyers.size(); ++i)
+            const int *demand = columns.demand[flower].data();
+#pragma omp simd reduction(+ : demand_sum)
+            for (int i = 0; i < columns.id.size(); ++i)
             {
-                demand_sum += buyers[i].demand[flower].load();
+                demand_sum += demand[i];
             }
 
-            avg_prices[flower] = seller_count > 0 ? price_sum / seller_count : 0.0;
+            avg_prices[flower] = seller_count > 0 ? (double)price_sum / seller_count / TICKS_PER_DOLLAR : 0.0;
             total_supply[flower] = supply_sum;
             total_demand[flower] = demand_sum;
         }
 
         // Print analysis
         std::cout << " Market Conditions:\n";
-        for (int i = 0; i < 3; ++i)
+        for (int i = 0; i < flowers; ++i)
         {
-            std::cout << "   " << FlowerNames[i] << ": Avg Price $" << std::fixed
+            std::cout << "   " << catalog.name(i) << ": Avg Price $" << std::fixed
                       << std::setprecision(2) << avg_prices[i] << ", Supply " << total_supply[i]
                       << ", Demand " << total_demand[i] << "\n";
         }
@@ -672,13 +3132,44 @@ public:
         printStatus();
 
         std::cout << "\n PARALLEL PROCESSING STATISTICS:\n";
-        std::cout << "Total Parallel Operations: " << parallel_operations.load() << "\n";
-        std::cout << "Peak Concurrent Trades: " << concurrent_trades.load() << "\n";
+        std::cout << "Total Parallel Operations: " << market_stats.read(MarketStats::ParallelOperations) << "\n";
+        std::cout << "Peak Concurrent Trades: " << market_stats.read(MarketStats::ConcurrentTrades) << "\n";
+        std::cout << "Stolen Matching Tasks: " << market_stats.read(MarketStats::StolenTasks) << "\n";
+        std::cout << "Flat-Combined Fills: " << market_stats.read(MarketStats::CombinedFills) << "\n";
         std::cout << "Threads Used: " << omp_get_max_threads() << "\n";
 
+        if (tuner.enabled())
+        {
+            std::cout << "\n LOOP TUNING:\n";
+            tuner.report();
+        }
+
+        if (lock_profiling)
+            printLockContention();
+
+        // Accesses are counted in the matching loop, not read from hardware
+        // counters, so the bandwidth is those counts times the agent size
+        std::cout << "\n NUMA NODES (matching phase, " << std::fixed << std::setprecision(1)
+                  << match_seconds * 1e3 << " ms; agent homes "
+                  << (homes_queried ? "from move_pages" : "from the first-touch model") << "):\n";
+        for (int node = 0; node < node_traffic.nodes(); ++node)
+        {
+            long long local = node_traffic.local(node), remote = node_traffic.remote(node);
+            std::cout << "   Node " << node << ": " << local << " local / " << remote << " remote agent accesses ("
+                      << std::setprecision(1) << (local + remote > 0 ? 100.0 * local / (local + remote) : 100.0)
+                      << "% local), " << std::setprecision(2)
+                      << (match_seconds > 0 ? node_traffic.bytes(node) / match_seconds / 1e6 : 0.0)
+                      << " MB/s agent state (estimated)\n";
+        }
+
         std::cout << "\n TRADE SUMMARY:\n";
-        std::cout << "Total Trades: " << total_trades.load() << "\n";
-        std::cout << "Total Market Volume: $" << std::fixed << std::setprecision(2) << total_volume.load() << "\n";
+        std::cout << "Total Trades: " << market_stats.read(MarketStats::Trades) << "\n";
+        std::cout << "Total Market Volume: $" << formatCents(market_stats.read(MarketStats::Volume)) << "\n";
+        std::cout << "Trade Journal: " << journal.drained() << " records"
+                  << (journal_path.empty() ? " (in memory)" : " written to " + journal_path) << "\n";
+        checkConservation();
+        std::cout << "State digest: " << std::hex << std::setw(16) << std::setfill('0') << stateDigest()
+                  << std::dec << std::setfill(' ') << "\n";
 
         // Parallel efficiency calculation
         std::vector<double> seller_efficiency(sellers.size());
@@ -689,10 +3180,10 @@ public:
         {
             int total_original = 0;
             int total_sold = 0;
-            for (int j = 0; j < 3; ++j)
+            for (int j = 0; j < flowers; ++j)
             {
-                total_original += sellers[i].original_quantity[j];
-                total_sold += (sellers[i].original_quantity[j] - sellers[i].quantity[j].load());
+                total_original += seller_info[i].original_quantity[j];
+                total_sold += (seller_info[i].original_quantity[j] - sellers[i].quantity[j].load());
             }
             seller_efficiency[i] = total_original > 0 ? (double)total_sold / total_original * 100 : 0.0;
         }
@@ -702,10 +3193,10 @@ public:
         {
             int total_original = 0;
             int total_bought = 0;
-            for (int j = 0; j < 3; ++j)
+            for (int j = 0; j < flowers; ++j)
             {
-                total_original += buyers[i].original_demand[j];
-                total_bought += (buyers[i].original_demand[j] - buyers[i].demand[j].load());
+                total_original += buyer_info[i].original_demand[j];
+                total_bought += (buyer_info[i].original_demand[j] - buyers[i].demand[j].load());
             }
             buyer_efficiency[i] = total_original > 0 ? (double)total_bought / total_original * 100 : 0.0;
         }
@@ -714,18 +3205,208 @@ public:
         std::cout << "Seller Performance:\n";
         for (int i = 0; i < sellers.size(); ++i)
         {
-            std::cout << "• " << sellers[i].name << ": " << std::fixed << std::setprecision(1)
-                      << seller_efficiency[i] << "% sold, $" << std::setprecision(2)
-                      << sellers[i].revenue.load() << " revenue\n";
+            std::cout << "• " << seller_info[i].name << ": " << std::fixed << std::setprecision(1)
+                      << seller_efficiency[i] << "% sold, $" << formatCents(sellers[i].revenue.load()) << " revenue\n";
         }
 
         std::cout << "\nBuyer Performance:\n";
         for (int i = 0; i < buyers.size(); ++i)
         {
-            std::cout << "• " << buyers[i].name << ": " << std::fixed << std::setprecision(1)
-                      << buyer_efficiency[i] << "% fulfilled, $" << std::setprecision(2)
-                      << buyers[i].spent.load() << " spent\n";
+            std::cout << "• " << buyer_info[i].name << ": " << std::fixed << std::setprecision(1)
+                      << buyer_efficiency[i] << "% fulfilled, $" << formatCents(buyers[i].spent.load()) << " spent\n";
+        }
+    }
+
+    // FNV-1a over every agent's final stock, demand, money and quotes; two runs
+    // ended in the same state exactly when their digests match
+    unsigned long long stateDigest()
+    {
+        unsigned long long hash = 1469598103934665603ULL;
+        auto mix = [&](long long value)
+        {
+            for (int k = 0; k < 8; ++k, value >>= 8)
+                hash = (hash ^ (value & 0xff)) * 1099511628211ULL;
+        };
+        for (Seller &seller : sellers)
+        {
+            mix(seller.revenue.load());
+            for (int j = 0; j < flowers; ++j)
+            {
+                mix(seller.quantity[j].load());
+                mix(seller.quote(j));
+            }
+        }
+        for (Buyer &buyer : buyers)
+        {
+            mix(buyer.budget.load());
+            mix(buyer.spent.load());
+            for (int j = 0; j < flowers; ++j)
+                mix(buyer.demand[j].load());
+        }
+        return hash;
+    }
+
+    // Integer money means every cent that left a buyer arrived at a seller and
+    // in the volume total; any mismatch is a settlement bug, not rounding
+    void checkConservation()
+    {
+        Cents spent = 0, revenue = 0, budget_drift = 0;
+        long long sold = 0, bought = 0, wanted = 0;
+
+#pragma omp parallel for reduction(+ : spent, budget_drift, bought, wanted)
+        for (int i = 0; i < buyers.size(); ++i)
+        {
+            spent += buyers[i].spent.load();
+            budget_drift += buyer_info[i].original_budget - buyers[i].budget.load() - buyers[i].spent.load();
+            for (int j = 0; j < flowers; ++j)
+            {
+                bought += buyer_info[i].original_demand[j] - buyers[i].demand[j].load();
+                wanted += buyers[i].demand[j].load();
+            }
+        }
+
+#pragma omp parallel for reduction(+ : revenue, sold)
+        for (int i = 0; i < sellers.size(); ++i)
+        {
+            revenue += sellers[i].revenue.load();
+            for (int j = 0; j < flowers; ++j)
+                sold += seller_info[i].original_quantity[j] - sellers[i].quantity[j].load();
+        }
+
+        bool balanced = spent == revenue && revenue == market_stats.read(MarketStats::Volume) && budget_drift == 0 &&
+                        sold == bought && wanted == market_stats.read(MarketStats::OutstandingDemand);
+        std::cout << "Conservation: spent $" << formatCents(spent) << ", revenue $" << formatCents(revenue)
+                  << ", units " << bought << "/" << sold << (balanced ? " (exact)" : " (MISMATCH)") << "\n";
+    }
+
+    // Settlement throughput on a synthetic market: the same stream of one-unit
+    // fills between random buyers and sellers is settled at 1, 2, 4, ... threads,
+    // once through the lock-free path and once under the per-agent locks
+    void runSettlementBenchmark(int max_threads, int fills = 2000000)
+    {
+        const int num_sellers = 64, num_buyers = 1024;
+        sellers.assign(num_sellers, Seller(flowers));
+        buyers.assign(num_buyers, Buyer(flowers));
+        allocateAgentLocks();
+
+        std::mt19937 gen(42);
+        std::vector<int> fill_buyer(fills), fill_seller(fills), fill_flower(fills);
+        for (int k = 0; k < fills; ++k)
+        {
+            fill_buyer[k] = gen() % num_buyers;
+            fill_seller[k] = gen() % num_sellers;
+            fill_flower[k] = gen() % flowers;
+        }
+
+        // Stock and budgets run out part-way, so both the fill and the rollback paths are exercised
+        auto reset = [&]()
+        {
+            for (Seller &seller : sellers)
+                for (int j = 0; j < flowers; ++j)
+                {
+                    seller.quantity[j].store(fills / num_sellers / flowers * 3 / 4);
+                    seller.setQuote(j, 100 + j);
+                    seller.revenue.store(0);
+                }
+            for (Buyer &buyer : buyers)
+                for (int j = 0; j < flowers; ++j)
+                {
+                    buyer.demand[j].store(fills / num_buyers);
+                    buyer.budget.store(toCents(fills / num_buyers * 0.9));
+                    buyer.spent.store(0);
+                }
+        };
+
+        std::cout << " Settlement benchmark: " << fills << " fills, " << num_buyers << " buyers, "
+                  << num_sellers << " sellers, " << omp_get_num_procs() << " CPUs\n";
+        std::cout << "   Threads   Lock-free fills/s   Locked fills/s   Speedup\n";
+
+        for (int threads = 1; threads <= max_threads; threads *= 2)
+        {
+            double rate[2];
+            for (int locked = 0; locked < 2; ++locked)
+            {
+                reset();
+                long long units = 0;
+                auto start = std::chrono::steady_clock::now();
+#pragma omp parallel for num_threads(threads) schedule(static, 1024) reduction(+ : units)
+                for (int k = 0; k < fills; ++k)
+                {
+                    int b = fill_buyer[k], s = fill_seller[k], f = fill_flower[k];
+                    units += locked ? settleLocked(b, s, f, 1, sellers[s].quote(f))
+                                    : settle(b, s, f, 1, sellers[s].quote(f));
+                }
+                double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                rate[locked] = fills / seconds;
+
+                // Every settled unit must be paid for exactly once
+                Cents spent = 0, revenue = 0;
+                for (Buyer &buyer : buyers)
+                    spent += buyer.spent.load();
+                for (Seller &seller : sellers)
+                    revenue += seller.revenue.load();
+                if (spent != revenue)
+                    std::cout << "   MISMATCH at " << threads << " threads: spent " << spent << " vs revenue " << revenue << "\n";
+            }
+            std::cout << "   " << std::setw(7) << threads << std::fixed << std::setprecision(0)
+                      << std::setw(20) << rate[0] << std::setw(17) << rate[1]
+                      << std::setprecision(2) << std::setw(9) << rate[0] / rate[1] << "x\n";
+        }
+    }
+
+    // Hot-seller throughput: every one-unit fill targets the same seller, in
+    // ten rounds with a cool-down check between them, with flat combining
+    // disabled and then switched on automatically
+    void runHotSellerBenchmark(int max_threads, int fills = 1000000)
+    {
+        const int num_buyers = 1024, rounds = 10;
+        sellers.assign(1, Seller(flowers));
+        buyers.assign(num_buyers, Buyer(flowers));
+        buyer_rank.clear();
+        resetCombiners();
+
+        std::cout << " Hot seller benchmark: " << fills << " fills on one seller, " << num_buyers << " buyers, "
+                  << omp_get_num_procs() << " CPUs\n";
+        std::cout << "   Threads    Direct fills/s  Combining fills/s   Speedup   Combined\n";
+
+        for (int threads = 1; threads <= max_threads; threads *= 2)
+        {
+            double rate[2];
+            long long combined = 0;
+            for (int mode = 0; mode < 2; ++mode)
+            {
+                flat_combining = mode == 1;
+                sellers[0].combining.store(false);
+                for (int j = 0; j < flowers; ++j)
+                {
+                    sellers[0].quantity[j].store(fills);
+                    sellers[0].setQuote(j, 100);
+                }
+                for (Buyer &buyer : buyers)
+                    for (int j = 0; j < flowers; ++j)
+                    {
+                        buyer.demand[j].store(fills);
+                        buyer.budget.store((Cents)fills * 100);
+                    }
+                market_stats.reset();
+
+                auto start = std::chrono::steady_clock::now();
+                for (int round = 0; round < rounds; ++round)
+                {
+#pragma omp parallel for num_threads(threads) schedule(static, 64)
+                    for (int k = 0; k < fills / rounds; ++k)
+                        settle(k % num_buyers, 0, k % flowers, 1, 100);
+                    coolSellers();
+                }
+                rate[mode] = fills / std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                combined = market_stats.read(MarketStats::CombinedFills);
+            }
+            std::cout << "   " << std::setw(7) << threads << std::fixed << std::setprecision(0)
+                      << std::setw(18) << rate[0] << std::setw(19) << rate[1]
+                      << std::setprecision(2) << std::setw(9) << rate[1] / rate[0] << "x"
+                      << std::setw(11) << combined << "\n";
         }
+        flat_combining = true;
     }
 
     std::string getCurrentTimestamp()
@@ -741,27 +3422,34 @@ public:
     {
         std::cout << "\n PARALLEL MARKET SUMMARY \n";
         std::cout << "OpenMP Threads: " << omp_get_max_threads() << "\n";
+        std::cout << "NUMA Nodes: " << numa.nodes() << ", threads "
+                  << (numa.pinned                                        ? "pinned close by the engine (master unbound)"
+                      : getenv("OMP_PROC_BIND") || getenv("OMP_PLACES") ? "placed by OMP_PLACES/OMP_PROC_BIND"
+                                                                        : "not pinned") << "\n";
         std::cout << "Sellers: " << sellers.size() << "\n";
         std::cout << "Buyers: " << buyers.size() << "\n";
-        std::cout << "Flower Types: 3 (Rose, Sunflower, Tulip)\n";
+        std::cout << "Flower Types: " << flowers << " (";
+        for (int i = 0; i < std::min(flowers, 5); ++i)
+            std::cout << (i > 0 ? ", " : "") << catalog.name(i);
+        std::cout << (flowers > 5 ? ", ...)\n" : ")\n");
 
         // Parallel calculation of totals
-        std::vector<int> total_supply(3, 0);
-        std::vector<int> total_demand(3, 0);
+        std::vector<int> total_supply(flowers, 0);
+        std::vector<int> total_demand(flowers, 0);
 
 #pragma omp parallel for
-        for (int flower = 0; flower < 3; ++flower)
+        for (int flower = 0; flower < flowers; ++flower)
         {
             int supply = 0, demand = 0;
 
             for (int i = 0; i < sellers.size(); ++i)
             {
-                supply += sellers[i].original_quantity[flower];
+                supply += seller_info[i].original_quantity[flower];
             }
 
             for (int i = 0; i < buyers.size(); ++i)
             {
-                demand += buyers[i].original_demand[flower];
+                demand += buyer_info[i].original_demand[flower];
             }
 
             total_supply[flower] = supply;
@@ -769,9 +3457,9 @@ public:
         }
 
         std::cout << "\nInitial Supply vs Demand (calculated in parallel):\n";
-        for (int i = 0; i < 3; ++i)
+        for (int i = 0; i < flowers; ++i)
         {
-            std::cout << "• " << FlowerNames[i] << ": Supply " << total_supply[i]
+            std::cout << "• " << catalog.name(i) << ": Supply " << total_supply[i]
                       << " vs Demand " << total_demand[i];
             if (total_supply[i] < total_demand[i])
             {
@@ -791,25 +3479,318 @@ public:
     }
 };
 
-int main()
+// Eligibility filter over n buyers: the original array-of-structs scan against
+// the column store with the scalar and the vector kernel. Every variant scans
+// all buyers for a sweep of asks and must select the same buyers.
+void runColumnBenchmark(int n)
 {
-    // Set OpenMP thread count
-    omp_set_num_threads(std::min(8, omp_get_max_threads()));
+    std::cout << " Eligibility filter benchmark: " << n << " buyers, sizeof(Buyer) = "
+              << sizeof(Buyer<3>) << " bytes, vector kernel: " << SimdKernelName << "\n";
+
+    std::vector<Buyer<3>> buyers(n);
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<> demand_dist(-5, 20);
+    std::uniform_real_distribution<> budget_dist(0, 800);
+    std::uniform_real_distribution<> price_dist(3.0, 7.0);
+    for (int i = 0; i < n; ++i)
+    {
+        for (int j = 0; j < 3; ++j)
+        {
+            buyers[i].demand[j].store(std::max(0, demand_dist(gen)));
+            buyers[i].buy_price[j] = toTick(price_dist(gen));
+        }
+        buyers[i].budget.store(budget_dist(gen) < 40 ? 100 : toCents(budget_dist(gen)));
+    }
 
-    std::cout << " Starting Parallel Flower Market Exchange\n";
-    std::cout << "Available CPU cores: " << omp_get_max_threads() << "\n";
-    std::cout << "Using " << omp_get_num_threads() << " threads\n";
+    AgentColumns cols;
+    cols.resizeBuyers(n, 3);
+    for (int i = 0; i < n; ++i)
+    {
+        cols.id[i] = i;
+        cols.budget[i] = buyers[i].budget.load();
+        for (int j = 0; j < 3; ++j)
+        {
+            cols.demand[j][i] = buyers[i].demand[j].load();
+            cols.buy_price[j][i] = buyers[i].buy_price[j];
+        }
+    }
+
+    std::vector<int> out(n);
+    const int asks = 24;
+    auto ask_at = [](int k)
+    { return toTick(3.0 + 4.0 * k / asks); };
+
+    auto time_ms = [&](auto &&filter, long long &selected)
+    {
+        selected = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int k = 0; k < asks; ++k)
+            selected += filter(k % 3, ask_at(k));
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / asks;
+    };
+
+    long long aos_count, scalar_count, simd_count;
+    double aos_ms = time_ms([&](int flower, int ask)
+                            {
+                                int count = 0;
+                                for (int i = 0; i < n; ++i)
+                                {
+                                    if (buyers[i].demand[flower].load() > 0 && buyers[i].buy_price[flower] >= ask &&
+                                        buyers[i].budget.load() >= ask)
+                                        out[count++] = i;
+                                }
+                                return count; },
+                            aos_count);
+    double scalar_ms = time_ms([&](int flower, int ask)
+                               { return selectEligibleScalar(cols, flower, ask, out.data()); },
+                               scalar_count);
+    double simd_ms = time_ms([&](int flower, int ask)
+                             { return selectEligible(cols, flower, ask, out.data()); },
+                             simd_count);
+
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "   Array of structs:      " << aos_ms << " ms/scan\n";
+    std::cout << "   Columns, scalar:       " << scalar_ms << " ms/scan (" << std::setprecision(2)
+              << aos_ms / scalar_ms << "x)\n";
+    std::cout << "   Columns, " << SimdKernelName << ":" << std::string(13 - strlen(SimdKernelName), ' ')
+              << std::setprecision(3) << simd_ms << " ms/scan (" << std::setprecision(2) << aos_ms / simd_ms << "x)\n";
+    std::cout << "   Selected " << aos_count << " buyers in total"
+              << (aos_count == scalar_count && aos_count == simd_count ? " (all variants agree)" : " (MISMATCH)") << "\n";
+}
+
+// Seller as laid out before the hot/cold split: counters packed between names
+// and timestamps, so neighbouring sellers share cache lines
+struct PackedSeller
+{
+    char name[20];
+    int flowers;
+    std::atomic<int> quantity[3];
+    int price[3];
+    std::string timestamp;
+    int original_quantity[3];
+    std::atomic<Cents> revenue;
+    std::atomic<int> trades_count;
+    omp_lock_t lock;
+};
+
+// False-sharing microbenchmark: every thread settles fills against its own
+// seller only, so any slowdown with more threads comes from cache lines shared
+// between neighbouring sellers, not from real contention
+void runFalseSharingBenchmark(int max_threads, int fills_per_thread = 5000000)
+{
+    std::cout << " False-sharing benchmark: " << fills_per_thread << " fills per thread, "
+              << omp_get_num_procs() << " CPUs\n";
+    std::cout << "   sizeof(PackedSeller) = " << sizeof(PackedSeller) << " bytes, sizeof(Seller) = "
+              << sizeof(Seller<3>) << " bytes (aligned to " << alignof(Seller<3>) << ")\n";
+    std::cout << "   Threads   Packed ns/fill   Isolated ns/fill   Speedup\n";
+
+    auto hammer = [&](auto &sellers, int threads)
+    {
+        auto start = std::chrono::steady_clock::now();
+#pragma omp parallel num_threads(threads)
+        {
+            auto &seller = sellers[omp_get_thread_num()];
+            for (int k = 0; k < fills_per_thread; ++k)
+            {
+                seller.quantity[k % 3].fetch_sub(1, std::memory_order_relaxed);
+                seller.revenue.fetch_add(100, std::memory_order_relaxed);
+                seller.trades_count.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        return ns / fills_per_thread;
+    };
+
+    for (int threads = 1; threads <= max_threads; threads *= 2)
+    {
+        std::vector<PackedSeller> packed(threads);
+        std::vector<Seller<3>> isolated(threads);
+        double packed_ns = hammer(packed, threads);
+        double isolated_ns = hammer(isolated, threads);
+        std::cout << "   " << std::setw(7) << threads << std::fixed << std::setprecision(2)
+                  << std::setw(17) << packed_ns << std::setw(19) << isolated_ns
+                  << std::setw(9) << packed_ns / isolated_ns << "x\n";
+    }
+}
+
+// Cost of recording a fill: each thread writes records into the journal while
+// the writer drains them in memory
+void runJournalBenchmark(int max_threads, int records_per_thread = 1000000)
+{
+    std::cout << " Trade journal benchmark: " << records_per_thread << " records per thread, "
+              << omp_get_num_procs() << " CPUs, sizeof(TradeRecord) = " << sizeof(TradeRecord) << " bytes\n";
+    std::cout << "   Threads   ns/record   Drained\n";
+
+    for (int threads = 1; threads <= max_threads; threads *= 2)
+    {
+        TradeJournal journal;
+        journal.start(nullptr, threads);
+        auto start = std::chrono::steady_clock::now();
+#pragma omp parallel num_threads(threads)
+        {
+            TradeRecord entry = {0, 100, 0, 0, 0, 1, 100, omp_get_thread_num()};
+            for (int k = 0; k < records_per_thread; ++k)
+            {
+                entry.buyer = k;
+                journal.record(entry);
+            }
+        }
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        journal.stop();
+        std::cout << "   " << std::setw(7) << threads << std::fixed << std::setprecision(2)
+                  << std::setw(12) << ns / records_per_thread << std::setw(10) << journal.drained() << "\n";
+    }
+}
 
-    FlowerMarket market;
+// How main asked for the exchange to be run
+struct ExchangeOptions
+{
+    bool continuous = false;
+    bool call_auction = false;
+    bool shared_nothing = false;
+    bool deterministic = false;
+    unsigned seed = 0;
+    const char *journal_path = nullptr;
+    const char *tuning_path = nullptr;
+    int log_level = LOG_TRADES;
+    bool profile_locks = false;
+};
+
+// Set up and run one market over the given catalog
+template <size_t NumFlowers>
+void runExchange(const FlowerCatalog &catalog, const ExchangeOptions &options)
+{
+    FlowerMarket<NumFlowers> market(catalog);
+    market.call_auction = options.call_auction;
+    market.shared_nothing = options.shared_nothing;
+    market.deterministic = options.deterministic;
+    market.seed = options.seed;
+    if (options.tuning_path)
+        market.openTuning(options.tuning_path);
+    market.startLogging(options.log_level);
+    if (!market.openJournal(options.journal_path))
+    {
+        std::cerr << "Cannot open trade journal " << options.journal_path << "\n";
+        return;
+    }
 
     // Initialize with generated data
     market.initializeMarket();
+    if (options.profile_locks)
+        market.profileLocks();
 
     // Print initial market summary
     market.printMarketSummary();
 
     // Run the parallel market simulation
-    market.runMarket();
+    if (options.continuous)
+        market.runContinuousMarket();
+    else
+        market.runMarket();
+}
+
+int main(int argc, char **argv)
+{
+    // "--continuous" runs the continuous double auction instead of rounds,
+    // "--call-auction" clears every round as a uniform-price batch auction,
+    // "--shared-nothing" runs rounds thread-per-core with sellers partitioned by core,
+    // "--deterministic" matches rounds by intent/resolve, identical at any thread count,
+    // "--seed N" generates the agents from N instead of std::random_device,
+    // "--catalog N" trades N generated SKUs on the runtime-sized engine,
+    // "--bench-columns [buyers]" only runs the eligibility filter benchmark,
+    // "--bench-settlement [threads]" only runs the settlement scaling benchmark,
+    // "--bench-hot-seller [threads]" only runs the flat-combining benchmark,
+    // "--bench-false-sharing [threads]" only runs the seller layout benchmark,
+    // "--bench-journal [threads]" only runs the trade journal benchmark,
+    // "--journal FILE" writes every fill to FILE as raw TradeRecords,
+    // "--log-level quiet|info|trades" picks how much is logged (default trades),
+    // "--tuning FILE" auto-tunes thread counts and schedules, keeping the choices in FILE,
+    // "--profile-locks" profiles lock contention and reports it per lock and per seller
+    ExchangeOptions options;
+    int catalog_size = 0;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--bench-columns") == 0)
+        {
+            runColumnBenchmark(i + 1 < argc ? atoi(argv[i + 1]) : 1000000);
+            return 0;
+        }
+        else if (strcmp(argv[i], "--bench-false-sharing") == 0)
+        {
+            runFalseSharingBenchmark(i + 1 < argc ? atoi(argv[i + 1]) : 8);
+            return 0;
+        }
+        else if (strcmp(argv[i], "--bench-journal") == 0)
+        {
+            runJournalBenchmark(i + 1 < argc ? atoi(argv[i + 1]) : 8);
+            return 0;
+        }
+        else if (strcmp(argv[i], "--bench-settlement") == 0)
+        {
+            FlowerCatalog catalog;
+            catalog.add("Rose");
+            catalog.add("Sunflower");
+            catalog.add("Tulip");
+            FlowerMarket<3>(catalog).runSettlementBenchmark(i + 1 < argc ? atoi(argv[i + 1]) : 64);
+            return 0;
+        }
+        else if (strcmp(argv[i], "--bench-hot-seller") == 0)
+        {
+            FlowerCatalog catalog;
+            catalog.add("Rose");
+            catalog.add("Sunflower");
+            catalog.add("Tulip");
+            FlowerMarket<3>(catalog).runHotSellerBenchmark(i + 1 < argc ? atoi(argv[i + 1]) : 16);
+            return 0;
+        }
+        else if (strcmp(argv[i], "--continuous") == 0)
+            options.continuous = true;
+        else if (strcmp(argv[i], "--call-auction") == 0)
+            options.call_auction = true;
+        else if (strcmp(argv[i], "--shared-nothing") == 0)
+            options.shared_nothing = true;
+        else if (strcmp(argv[i], "--deterministic") == 0)
+            options.deterministic = true;
+        else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+            options.seed = strtoul(argv[++i], nullptr, 10);
+        else if (strcmp(argv[i], "--catalog") == 0 && i + 1 < argc)
+            catalog_size = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--journal") == 0 && i + 1 < argc)
+            options.journal_path = argv[++i];
+        else if (strcmp(argv[i], "--tuning") == 0 && i + 1 < argc)
+            options.tuning_path = argv[++i];
+        else if (strcmp(argv[i], "--profile-locks") == 0)
+            options.profile_locks = true;
+        else if (strcmp(argv[i], "--log-level") == 0 && i + 1 < argc)
+        {
+            const char *name = argv[++i];
+            options.log_level = strcmp(name, "quiet") == 0 ? LOG_QUIET : strcmp(name, "info") == 0 ? LOG_INFO
+                                                                                            : LOG_TRADES;
+        }
+    }
+
+    // Set OpenMP thread count; the tuner starts from every core and works down
+    omp_set_num_threads(options.tuning_path ? omp_get_num_procs() : std::min(8, omp_get_max_threads()));
+
+    std::cout << " Starting Parallel Flower Market Exchange\n";
+    std::cout << "Available CPU cores: " << omp_get_max_threads() << "\n";
+    std::cout << "Using " << omp_get_num_threads() << " threads\n";
+
+    FlowerCatalog catalog;
+    if (catalog_size > 0)
+    {
+        for (int i = 0; i < catalog_size; ++i)
+            catalog.add("SKU-" + std::to_string(i + 1));
+        runExchange<DynamicFlowers>(catalog, options);
+    }
+    else
+    {
+        catalog.add("Rose");
+        catalog.add("Sunflower");
+        catalog.add("Tulip");
+        runExchange<3>(catalog, options);
+    }
 
     return 0;
-}
\ No newline at end of file
+}
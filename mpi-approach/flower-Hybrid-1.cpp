@@ -14,6 +14,13 @@
 #include <numeric>
 #include <random>
 #include <atomic>
+#include <cmath>
+#include <climits>
+#include <functional>
+#include <cstddef>
+
+#include "../common/lock-profile.h"
+#include "../common/trade-log.h"
 
 enum FlowerType
 {
@@ -24,28 +31,49 @@ enum FlowerType
 
 const char *FlowerNames[3] = {"Rose", "Sunflower", "Tulip"};
 
+// Money is held as integer cents and prices as integer ticks of one cent, so
+// balances move with plain atomic adds and totals are exact on every rank
+typedef long long Cents;
+const int PRICE_DROP = 25;  // Ticks an unsold ask falls per round
+const int PRICE_FLOOR = 30; // Asks never drop below this
+
+int toTick(double dollars)
+{
+    long t = std::lround(dollars * 100);
+    return t < 0 ? 0 : (int)t;
+}
+
+Cents toCents(double dollars)
+{
+    return std::llround(dollars * 100);
+}
+
+// Format cents (or price ticks) as dollars with two decimals
+std::string formatCents(Cents amount)
+{
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%s%lld.%02lld", amount < 0 ? "-" : "", std::llabs(amount) / 100, std::llabs(amount) % 100);
+    return buf;
+}
+
+// Between rounds the owning rank's copy of a seller; during a round the
+// seller's stock, asks and takings live in HybridFlowerMarket's market window
 struct Seller
 {
     char name[20];
     std::atomic<int> quantity[3];
-    double price[3];
+    int price[3]; // Ticks
     int original_quantity[3];
-    std::atomic<double> revenue;
+    std::atomic<Cents> revenue;
     std::atomic<int> trades_count;
-    omp_lock_t lock;
     int process_id; // Which MPI process owns this seller
+    int seller_id;  // Stable across ranks and rounds
 
-    Seller() : revenue(0.0), trades_count(0), process_id(0)
-    {
-        omp_init_lock(&lock);
-    }
-
-    ~Seller()
-    {
-        omp_destroy_lock(&lock);
-    }
+    Seller() : revenue(0), trades_count(0), process_id(0), seller_id(0) {}
 
-    Seller(const Seller &other) : revenue(other.revenue.load()), trades_count(other.trades_count.load()), process_id(other.process_id)
+    Seller(const Seller &other)
+        : revenue(other.revenue.load()), trades_count(other.trades_count.load()), process_id(other.process_id),
+          seller_id(other.seller_id)
     {
         strcpy(name, other.name);
         for (int i = 0; i < 3; ++i)
@@ -54,7 +82,6 @@ struct Seller
             price[i] = other.price[i];
             original_quantity[i] = other.original_quantity[i];
         }
-        omp_init_lock(&lock);
     }
 
     Seller &operator=(const Seller &other)
@@ -71,6 +98,7 @@ struct Seller
             revenue.store(other.revenue.load());
             trades_count.store(other.trades_count.load());
             process_id = other.process_id;
+            seller_id = other.seller_id;
         }
         return *this;
     }
@@ -81,24 +109,16 @@ struct Buyer
     char name[20];
     std::atomic<int> demand[3];
     int original_demand[3];
-    std::atomic<double> budget;
-    double original_budget;
-    double buy_price[3];
+    std::atomic<Cents> budget;
+    Cents original_budget;
+    int buy_price[3]; // Ticks
     int priority;
-    std::atomic<double> spent;
+    std::atomic<Cents> spent;
     std::atomic<int> purchases_count;
-    omp_lock_t lock;
+    ProfiledOmpLock lock;
     int process_id; // Which MPI process owns this buyer
 
-    Buyer() : spent(0.0), purchases_count(0), process_id(0)
-    {
-        omp_init_lock(&lock);
-    }
-
-    ~Buyer()
-    {
-        omp_destroy_lock(&lock);
-    }
+    Buyer() : spent(0), purchases_count(0), process_id(0) {}
 
     Buyer(const Buyer &other) : spent(other.spent.load()), purchases_count(other.purchases_count.load()), process_id(other.process_id)
     {
@@ -112,7 +132,6 @@ struct Buyer
         budget.store(other.budget.load());
         original_budget = other.original_budget;
         priority = other.priority;
-        omp_init_lock(&lock);
     }
 
     Buyer &operator=(const Buyer &other)
@@ -143,20 +162,95 @@ struct TradeRecord
     char seller_name[20];
     int flower_type;
     int quantity;
-    double price_per_unit;
-    double total_cost;
+    int price_per_unit; // Ticks
+    Cents total_cost;
     int thread_id;
     int process_id;
 };
 
 // MPI message structures
-struct MarketUpdate
+
+// One seller as every rank sees it for a round. Sellers keep the same ID for
+// the whole run; IDs are assigned in rank order, so gathering every rank's
+// quotes in rank order leaves quote i describing seller i.
+struct SellerQuote
 {
-    int seller_quantities[3];
-    double seller_prices[3];
-    int buyer_demands[3];
-    double buyer_budget;
+    int seller_id;
     int process_id;
+    int quantity[3];
+    int price[3]; // Ticks
+    char name[20];
+};
+
+// Agents [blockStart, blockStart + blockCount) of `total` belong to `rank`
+int blockCount(int total, int rank, int ranks)
+{
+    return total / ranks + (rank < total % ranks ? 1 : 0);
+}
+
+int blockStart(int total, int rank, int ranks)
+{
+    return rank * (total / ranks) + std::min(rank, total % ranks);
+}
+
+const size_t CACHE_LINE = 64;
+
+// Market counters of this rank, sharded per thread. Each thread adds to its own
+// cache-line shard with relaxed atomics and reads sum the shards; totals across
+// ranks come from HybridFlowerMarket::globalStats.
+class MarketStats
+{
+public:
+    enum Counter
+    {
+        Trades,
+        Volume,       // Cents
+        RemoteTrades, // Fills against a seller on another rank
+        CounterCount
+    };
+
+    MarketStats()
+    {
+        for (Shard &shard : shards)
+            for (std::atomic<long long> &value : shard.value)
+                value.store(0, std::memory_order_relaxed);
+    }
+
+    void add(Counter counter, long long amount)
+    {
+        shards[shardIndex()].value[counter].fetch_add(amount, std::memory_order_relaxed);
+    }
+
+    long long read(Counter counter) const
+    {
+        long long total = 0;
+        for (const Shard &shard : shards)
+            total += shard.value[counter].load(std::memory_order_relaxed);
+        return total;
+    }
+
+private:
+    static const int Shards = 64;
+
+    struct alignas(CACHE_LINE) Shard
+    {
+        std::atomic<long long> value[CounterCount];
+    };
+    Shard shards[Shards];
+
+    static int shardIndex()
+    {
+        static std::atomic<int> next(0);
+        thread_local int index = next.fetch_add(1) % Shards;
+        return index;
+    }
+};
+
+// Log levels, set at run time with --log-level
+enum LogLevel
+{
+    LOG_QUIET = 0, // Round headers and reports only
+    LOG_TRADES = 1 // Plus one line per local fill
 };
 
 class HybridFlowerMarket
@@ -164,27 +258,134 @@ class HybridFlowerMarket
 private:
     std::vector<Seller> local_sellers;
     std::vector<Buyer> local_buyers;
-    std::vector<Seller> global_sellers; // All sellers across all processes
-    std::vector<Buyer> global_buyers;   // All buyers across all processes
+    std::vector<SellerQuote> global_sellers; // Every rank's sellers, indexed by seller ID
+    std::vector<SellerQuote> local_quotes;   // This rank's part of global_sellers
+    std::vector<int> seller_counts;          // Sellers per rank
+    std::vector<int> seller_starts;          // First seller ID of each rank
+    MPI_Datatype quote_type = MPI_DATATYPE_NULL;
+
+    // Seller state any rank can trade against one-sided. Each rank exposes
+    // its sellers' stock, asks, revenue and fill count in market_win; a
+    // buyer's thread reserves stock with MPI_Fetch_and_op and books the
+    // revenue with MPI_Accumulate, so the owning rank's CPU takes no part in
+    // a trade. Slots are long longs, SellerSlots per local seller.
+    enum SellerSlot
+    {
+        StockSlot = 0,   // Flower f's stock at 2f, its ask in ticks at 2f + 1
+        AskSlot = 1,
+        RevenueSlot = 6, // Cents
+        FillsSlot = 7,
+        SellerSlots = 8
+    };
+    MPI_Win market_win = MPI_WIN_NULL;
+    long long *market_slots = nullptr; // This rank's part of the window
+    bool rma_threads = false;          // MPI takes RMA calls from every thread at once
+    ProfiledMutex rma_mutex;           // Serializes RMA calls when it does not
     std::vector<TradeRecord> trade_history;
-    std::mutex trade_mutex;
-    std::mutex print_mutex;
-    std::atomic<int> total_trades;
-    std::atomic<double> total_volume;
+    ProfiledMutex trade_mutex;
+    ProfiledMutex print_mutex;
+    // Contention profiles, filled in by profileLocks() and empty when profiling
+    // is off. Buyer profiles are indexed like the local buyers; seller profiles
+    // by seller ID, and time this rank's threads spent reserving that seller's stock.
+    std::vector<LockProfile> seller_locks;
+    std::vector<LockProfile> buyer_locks;
+    LockProfile trade_lock, print_lock, rma_lock;
+    bool lock_profiling = false;
+    MarketStats market_stats;
+    AsyncLogger logger;
 
     // MPI variables
     int mpi_rank;
     int mpi_size;
 
 public:
-    HybridFlowerMarket() : total_trades(0), total_volume(0.0), mpi_rank(0), mpi_size(1) {}
+    HybridFlowerMarket() : mpi_rank(0), mpi_size(1) {}
+
+    enum LogKind
+    {
+        FillEvent // buyer, seller ID, flower, quantity, cost
+    };
+
+    // Start this rank's logger thread at the given LogLevel; fills are logged
+    // as (buyer, seller ID, flower, quantity, cost) and named on the logger thread
+    void startLogging(int level)
+    {
+        logger.setLevel(level);
+        logger.start([this](std::ostream &out, const LogEvent &event)
+                     {
+                         const long long *a = event.arg;
+                         out << "[P" << mpi_rank << ":T" << event.thread_id << "] "
+                             << local_buyers[a[0]].name << " bought " << a[3]
+                             << " " << FlowerNames[a[2]] << "(s) from " << global_sellers[a[1]].name
+                             << " for $" << formatCents(a[4]) << "\n"; });
+    }
+
+    // Attach a LockProfile to every lock on this rank; call after initializeMarket
+    void profileLocks()
+    {
+        seller_locks = std::vector<LockProfile>(global_sellers.size());
+        buyer_locks = std::vector<LockProfile>(local_buyers.size());
+        for (int i = 0; i < local_buyers.size(); ++i)
+            local_buyers[i].lock.profile(&buyer_locks[i]);
+        trade_mutex.profile(&trade_lock);
+        print_mutex.profile(&print_lock);
+        rma_mutex.profile(&rma_lock);
+        lock_profiling = true;
+    }
+
+    // This rank's locks, then a heatmap and table of its stock reservations per seller
+    void printLockContention()
+    {
+        LockProfile all_buyers;
+        for (const LockProfile &profile : buyer_locks)
+            all_buyers.add(profile);
+
+        std::cout << "Lock Contention:\n";
+        LockProfile::printHeader();
+        trade_lock.print("trade_mutex");
+        print_lock.print("print_mutex");
+        if (!rma_threads)
+            rma_lock.print("rma_mutex");
+        all_buyers.print("buyer locks (all)");
+        std::cout << "Stock Reservation Heatmap by Seller (wait time, log scale):\n";
+        printLockHeatmap(seller_locks);
+        LockProfile::printHeader();
+        for (int i = 0; i < global_sellers.size(); ++i)
+            seller_locks[i].print(global_sellers[i].name);
+    }
+
+    // Counters of this rank; safe to read from any thread while the market runs
+    const MarketStats &stats() const { return market_stats; }
+
+    // Counters summed over every rank; collective, so all ranks must call it
+    std::vector<long long> globalStats() const
+    {
+        std::vector<long long> local(MarketStats::CounterCount), total(MarketStats::CounterCount);
+        for (int c = 0; c < MarketStats::CounterCount; ++c)
+            local[c] = market_stats.read((MarketStats::Counter)c);
+        MPI_Allreduce(local.data(), total.data(), MarketStats::CounterCount, MPI_LONG_LONG, MPI_SUM, MPI_COMM_WORLD);
+        return total;
+    }
 
     void initializeMPI(int argc, char **argv)
     {
-        MPI_Init(&argc, &argv);
+        // Trading threads issue their own RMA calls; without MPI_THREAD_MULTIPLE
+        // they take turns under rma_mutex, which MPI only allows from
+        // MPI_THREAD_SERIALIZED up
+        int provided;
+        MPI_Init_thread(&argc, &argv, MPI_THREAD_MULTIPLE, &provided);
+        rma_threads = provided == MPI_THREAD_MULTIPLE;
         MPI_Comm_rank(MPI_COMM_WORLD, &mpi_rank);
         MPI_Comm_size(MPI_COMM_WORLD, &mpi_size);
 
+        if (provided < MPI_THREAD_SERIALIZED)
+        {
+            if (mpi_rank == 0)
+                std::cerr << "MPI provides thread level " << provided
+                          << "; OpenMP trading threads need at least MPI_THREAD_SERIALIZED\n";
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+
         if (mpi_rank == 0)
         {
             std::cout << "Hybrid MPI+OpenMP Flower Market\n";
@@ -195,9 +396,12 @@ public:
 
     void initializeMarket()
     {
-        // Each process gets a subset of sellers and buyers
-        int sellers_per_process = 5 / mpi_size + (mpi_rank < (5 % mpi_size) ? 1 : 0);
-        int buyers_per_process = 8 / mpi_size + (mpi_rank < (8 % mpi_size) ? 1 : 0);
+        // Each process gets a contiguous block of sellers and of buyers
+        const int total_sellers = 5, total_buyers = 8;
+        int sellers_per_process = blockCount(total_sellers, mpi_rank, mpi_size);
+        int buyers_per_process = blockCount(total_buyers, mpi_rank, mpi_size);
+        int first_seller = blockStart(total_sellers, mpi_rank, mpi_size);
+        int first_buyer = blockStart(total_buyers, mpi_rank, mpi_size);
 
         local_sellers.resize(sellers_per_process);
         local_buyers.resize(buyers_per_process);
@@ -208,11 +412,12 @@ public:
 #pragma omp parallel for
         for (int i = 0; i < sellers_per_process; ++i)
         {
-            int global_seller_id = mpi_rank * (5 / mpi_size) + i;
+            int global_seller_id = first_seller + i;
             if (global_seller_id < seller_names.size())
             {
                 strcpy(local_sellers[i].name, seller_names[global_seller_id].c_str());
                 local_sellers[i].process_id = mpi_rank;
+                local_sellers[i].seller_id = global_seller_id;
 
                 std::random_device rd;
                 std::mt19937 gen(rd() + global_seller_id);
@@ -224,10 +429,10 @@ public:
                     int qty = qty_dist(gen);
                     local_sellers[i].quantity[j].store(qty);
                     local_sellers[i].original_quantity[j] = qty;
-                    local_sellers[i].price[j] = price_dist(gen);
+                    local_sellers[i].price[j] = toTick(price_dist(gen));
                 }
 
-                local_sellers[i].revenue.store(0.0);
+                local_sellers[i].revenue.store(0);
                 local_sellers[i].trades_count.store(0);
             }
         }
@@ -238,7 +443,7 @@ public:
 #pragma omp parallel for
         for (int i = 0; i < buyers_per_process; ++i)
         {
-            int global_buyer_id = mpi_rank * (8 / mpi_size) + i;
+            int global_buyer_id = first_buyer + i;
             if (global_buyer_id < buyer_names.size())
             {
                 strcpy(local_buyers[i].name, buyer_names[global_buyer_id].c_str());
@@ -256,18 +461,31 @@ public:
                     int demand = demand_dist(gen);
                     local_buyers[i].demand[j].store(demand);
                     local_buyers[i].original_demand[j] = demand;
-                    local_buyers[i].buy_price[j] = price_dist(gen);
+                    local_buyers[i].buy_price[j] = toTick(price_dist(gen));
                 }
 
-                double budget = budget_dist(gen);
+                Cents budget = toCents(budget_dist(gen));
                 local_buyers[i].budget.store(budget);
                 local_buyers[i].original_budget = budget;
                 local_buyers[i].priority = priority_dist(gen);
-                local_buyers[i].spent.store(0.0);
+                local_buyers[i].spent.store(0);
                 local_buyers[i].purchases_count.store(0);
             }
         }
 
+        // Quote exchange layout; fixed for the run, so shareMarketData only moves data
+        seller_counts.resize(mpi_size);
+        seller_starts.resize(mpi_size);
+        for (int proc = 0; proc < mpi_size; ++proc)
+        {
+            seller_counts[proc] = blockCount(total_sellers, proc, mpi_size);
+            seller_starts[proc] = blockStart(total_sellers, proc, mpi_size);
+        }
+        global_sellers.resize(total_sellers);
+        local_quotes.resize(sellers_per_process);
+        commitQuoteType();
+        openMarketWindow();
+
         // Synchronize all processes
         MPI_Barrier(MPI_COMM_WORLD);
 
@@ -278,85 +496,139 @@ public:
         }
     }
 
-    void shareMarketData()
+    // SellerQuote as an MPI datatype: the fields are described explicitly
+    // rather than sent as raw bytes, and the extent is resized to the struct
+    // so arrays of quotes keep the compiler's padding
+    void commitQuoteType()
     {
-        // Gather all market data from all processes
-        global_sellers.clear();
-        global_buyers.clear();
+        int lengths[5] = {1, 1, 3, 3, 20};
+        MPI_Aint offsets[5] = {offsetof(SellerQuote, seller_id), offsetof(SellerQuote, process_id),
+                               offsetof(SellerQuote, quantity), offsetof(SellerQuote, price),
+                               offsetof(SellerQuote, name)};
+        MPI_Datatype types[5] = {MPI_INT, MPI_INT, MPI_INT, MPI_INT, MPI_CHAR};
+        MPI_Datatype packed;
+        MPI_Type_create_struct(5, lengths, offsets, types, &packed);
+        MPI_Type_create_resized(packed, 0, sizeof(SellerQuote), &quote_type);
+        MPI_Type_commit(&quote_type);
+        MPI_Type_free(&packed);
+    }
 
-        // Collect seller data
-        for (int proc = 0; proc < mpi_size; ++proc)
+    // Expose this rank's sellers in market_win and open one passive-target
+    // epoch on every rank for the rest of the run
+    void openMarketWindow()
+    {
+        MPI_Win_allocate((MPI_Aint)local_sellers.size() * SellerSlots * sizeof(long long), sizeof(long long),
+                         MPI_INFO_NULL, MPI_COMM_WORLD, &market_slots, &market_win);
+        for (int i = 0; i < local_sellers.size(); ++i)
         {
-            if (proc == mpi_rank)
+            long long *slots = market_slots + i * SellerSlots;
+            for (int j = 0; j < 3; ++j)
             {
-                // Send local sellers to all other processes
-                for (const auto &seller : local_sellers)
-                {
-                    // Create a simple data structure to send
-                    MarketUpdate update;
-                    for (int i = 0; i < 3; ++i)
-                    {
-                        update.seller_quantities[i] = seller.quantity[i].load();
-                        update.seller_prices[i] = seller.price[i];
-                    }
-                    update.process_id = mpi_rank;
-
-                    MPI_Bcast(&update, sizeof(MarketUpdate), MPI_BYTE, proc, MPI_COMM_WORLD);
-
-                    // Also broadcast seller name
-                    char name_buf[20];
-                    strcpy(name_buf, seller.name);
-                    MPI_Bcast(name_buf, 20, MPI_CHAR, proc, MPI_COMM_WORLD);
-                }
+                slots[StockSlot + 2 * j] = local_sellers[i].quantity[j].load();
+                slots[AskSlot + 2 * j] = local_sellers[i].price[j];
             }
-            else
-            {
-                // Receive sellers from process 'proc'
-                int sellers_from_proc = (proc < (5 % mpi_size)) ? (5 / mpi_size + 1) : (5 / mpi_size);
-
-                for (int i = 0; i < sellers_from_proc; ++i)
-                {
-                    MarketUpdate update;
-                    MPI_Bcast(&update, sizeof(MarketUpdate), MPI_BYTE, proc, MPI_COMM_WORLD);
-
-                    char name_buf[20];
-                    MPI_Bcast(name_buf, 20, MPI_CHAR, proc, MPI_COMM_WORLD);
-
-                    // Create seller object
-                    Seller remote_seller;
-                    strcpy(remote_seller.name, name_buf);
-                    remote_seller.process_id = proc;
-                    for (int j = 0; j < 3; ++j)
-                    {
-                        remote_seller.quantity[j].store(update.seller_quantities[j]);
-                        remote_seller.price[j] = update.seller_prices[j];
-                    }
+            slots[RevenueSlot] = 0;
+            slots[FillsSlot] = 0;
+        }
+        MPI_Win_lock_all(MPI_MODE_NOCHECK, market_win);
+        MPI_Win_sync(market_win);
+    }
 
-                    global_sellers.push_back(remote_seller);
-                }
-            }
+    // Copy the round's results out of the window once every rank has
+    // finished trading; the Seller structs are what reports read
+    void pullMarketWindow()
+    {
+        MPI_Win_sync(market_win);
+        for (int i = 0; i < local_sellers.size(); ++i)
+        {
+            const long long *slots = market_slots + i * SellerSlots;
+            for (int j = 0; j < 3; ++j)
+                local_sellers[i].quantity[j].store(slots[StockSlot + 2 * j]);
+            local_sellers[i].revenue.store(slots[RevenueSlot]);
+            local_sellers[i].trades_count.store(slots[FillsSlot]);
         }
+    }
+
+    // Read one flower's stock and ask from a seller's window slots
+    void readFlower(int owner, MPI_Aint slot, long long *stock_and_ask)
+    {
+        std::unique_lock<ProfiledMutex> serial(rma_mutex, std::defer_lock);
+        if (!rma_threads)
+            serial.lock();
+        long long unused[2] = {0, 0};
+        MPI_Get_accumulate(unused, 2, MPI_LONG_LONG, stock_and_ask, 2, MPI_LONG_LONG, owner, slot, 2, MPI_LONG_LONG,
+                           MPI_NO_OP, market_win);
+        MPI_Win_flush(owner, market_win);
+    }
 
-        // Add local sellers to global list
-        for (const auto &seller : local_sellers)
+    // Take up to `want` units from the stock slot with one fetch-and-add,
+    // handing back whatever the stock did not cover. While a refund is in
+    // flight the stock can read below zero, which every reader treats as sold
+    // out. Returns the units taken.
+    int reserveStock(int owner, MPI_Aint slot, int want, bool *overdrawn)
+    {
+        std::unique_lock<ProfiledMutex> serial(rma_mutex, std::defer_lock);
+        if (!rma_threads)
+            serial.lock();
+        long long take = -want, before;
+        MPI_Fetch_and_op(&take, &before, MPI_LONG_LONG, owner, slot, MPI_SUM, market_win);
+        MPI_Win_flush(owner, market_win);
+        long long got = std::max(0LL, std::min<long long>(want, before));
+        *overdrawn = got < want;
+        if (got < want)
         {
-            global_sellers.push_back(seller);
+            long long refund = want - got;
+            MPI_Accumulate(&refund, 1, MPI_LONG_LONG, owner, slot, 1, MPI_LONG_LONG, MPI_SUM, market_win);
+            MPI_Win_flush(owner, market_win);
         }
+        return got;
+    }
 
-        // Similar process for buyers (simplified)
-        for (const auto &buyer : local_buyers)
+    // Book a fill's revenue and count with the seller
+    void bookFill(int owner, MPI_Aint seller_base, Cents cost)
+    {
+        std::unique_lock<ProfiledMutex> serial(rma_mutex, std::defer_lock);
+        if (!rma_threads)
+            serial.lock();
+        long long booked[2] = {cost, 1};
+        MPI_Accumulate(booked, 2, MPI_LONG_LONG, owner, seller_base + RevenueSlot, 2, MPI_LONG_LONG, MPI_SUM,
+                       market_win);
+        MPI_Win_flush(owner, market_win);
+    }
+
+    // Refresh every rank's view of all sellers with one MPI_Allgatherv of the
+    // local quotes; global_sellers is sized once and overwritten in place.
+    // Asks dropped since the last round are published to the window first.
+    void shareMarketData()
+    {
+        for (int i = 0; i < local_sellers.size(); ++i)
+            for (int j = 0; j < 3; ++j)
+                market_slots[i * SellerSlots + AskSlot + 2 * j] = local_sellers[i].price[j];
+        MPI_Win_sync(market_win);
+
+        for (int i = 0; i < local_sellers.size(); ++i)
         {
-            global_buyers.push_back(buyer);
+            const Seller &seller = local_sellers[i];
+            SellerQuote &quote = local_quotes[i];
+            quote.seller_id = seller.seller_id;
+            quote.process_id = mpi_rank;
+            for (int j = 0; j < 3; ++j)
+            {
+                quote.quantity[j] = seller.quantity[j].load();
+                quote.price[j] = seller.price[j];
+            }
+            strcpy(quote.name, seller.name);
         }
 
-        MPI_Barrier(MPI_COMM_WORLD);
+        MPI_Allgatherv(local_quotes.data(), local_quotes.size(), quote_type, global_sellers.data(),
+                       seller_counts.data(), seller_starts.data(), quote_type, MPI_COMM_WORLD);
     }
 
     void printStatus()
     {
         if (mpi_rank == 0)
         {
-            std::lock_guard<std::mutex> lock(print_mutex);
+            std::lock_guard<ProfiledMutex> lock(print_mutex);
 
             std::cout << "\n"
                       << std::string(70, '=') << "\n";
@@ -368,13 +640,13 @@ public:
             for (const auto &seller : local_sellers)
             {
                 std::cout << " " << seller.name << " (Process " << seller.process_id
-                          << ", Revenue: $" << std::fixed << std::setprecision(2) << seller.revenue.load() << ")\n";
+                          << ", Revenue: $" << formatCents(seller.revenue.load()) << ")\n";
 
                 for (int j = 0; j < 3; ++j)
                 {
                     std::cout << "   " << FlowerNames[j] << ": " << seller.quantity[j].load()
                               << "/" << seller.original_quantity[j]
-                              << " @ $" << seller.price[j] << "\n";
+                              << " @ $" << formatCents(seller.price[j]) << "\n";
                 }
             }
 
@@ -392,8 +664,8 @@ public:
                                   << "/" << buyer.original_demand[j] << "\n";
                     }
                 }
-                std::cout << "   Budget: $" << std::fixed << std::setprecision(2)
-                          << buyer.budget.load() << "/$" << buyer.original_budget << "\n";
+                std::cout << "   Budget: $" << formatCents(buyer.budget.load())
+                          << "/$" << formatCents(buyer.original_budget) << "\n";
             }
         }
     }
@@ -422,40 +694,29 @@ public:
                 // Try to buy from any seller (local or remote)
                 for (int seller_idx = 0; seller_idx < global_sellers.size(); ++seller_idx)
                 {
-                    if (global_sellers[seller_idx].quantity[flower].load() <= 0)
+                    if (global_sellers[seller_idx].quantity[flower] <= 0)
                         continue;
 
                     // Check if buyer can afford this seller's price
                     if (local_buyers[buyer_idx].buy_price[flower] >= global_sellers[seller_idx].price[flower] &&
                         local_buyers[buyer_idx].budget.load() >= global_sellers[seller_idx].price[flower])
                     {
-
-                        // If seller is remote, we need MPI communication
-                        if (global_sellers[seller_idx].process_id != mpi_rank)
-                        {
-                            // Send trade request to remote process
-                            if (requestRemoteTrade(buyer_idx, seller_idx, flower))
-                            {
-                                any_trade = true;
-                                break;
-                            }
-                        }
-                        else
+                        // Local and remote sellers alike are settled through the market window
+                        if (executeTrade(buyer_idx, seller_idx, flower))
                         {
-                            // Local trade
-                            if (executeLocalTrade(buyer_idx, seller_idx, flower))
-                            {
-                                any_trade = true;
-                                break;
-                            }
+                            any_trade = true;
+                            break;
                         }
                     }
                 }
             }
         }
 
-        // Synchronize all processes
+        // Synchronize all processes; every RMA call was flushed as it was made,
+        // so after the barrier each rank's window holds the round's final state
+        logger.flush();
         MPI_Barrier(MPI_COMM_WORLD);
+        pullMarketWindow();
 
         // Reduce any_trade across all processes
         bool global_any_trade = false;
@@ -464,114 +725,82 @@ public:
         return global_any_trade;
     }
 
-    bool requestRemoteTrade(int buyer_idx, int seller_idx, int flower)
-    {
-        // Simplified remote trade request
-        // In a real implementation, you would send detailed trade requests
-        // For now, we'll just simulate some remote communication
-
-        int target_process = global_sellers[seller_idx].process_id;
-
-        // Send trade request (simplified)
-        struct TradeRequest
-        {
-            int flower_type;
-            int quantity;
-            double max_price;
-            int buyer_process;
-        } request;
-
-        request.flower_type = flower;
-        request.quantity = std::min(local_buyers[buyer_idx].demand[flower].load(), 5);
-        request.max_price = local_buyers[buyer_idx].buy_price[flower];
-        request.buyer_process = mpi_rank;
-
-        // For simplicity, we'll just return false (no remote trades in this basic version)
-        return false;
-    }
-
-    bool executeLocalTrade(int buyer_idx, int seller_idx, int flower)
+    // Buy from seller `seller_idx` (a seller ID), on this rank or another.
+    // The buyer is always local and its lock keeps this rank's threads from
+    // overspending it; the seller side is settled by RMA atomics alone.
+    bool executeTrade(int buyer_idx, int seller_idx, int flower)
     {
-        // Find the corresponding local seller
-        int local_seller_idx = -1;
-        for (int i = 0; i < local_sellers.size(); ++i)
+        const SellerQuote &quote = global_sellers[seller_idx];
+        int owner = quote.process_id;
+        MPI_Aint seller_base = (MPI_Aint)(quote.seller_id - seller_starts[owner]) * SellerSlots;
+        MPI_Aint stock_slot = seller_base + StockSlot + 2 * flower;
+        Buyer &buyer = local_buyers[buyer_idx];
+
+        buyer.lock.set();
+
+        // The ask may have moved since the quote was gathered, so trade at the window's
+        long long stock_and_ask[2];
+        readFlower(owner, stock_slot, stock_and_ask);
+        int ask = (int)stock_and_ask[1];
+        int buyer_demand = buyer.demand[flower].load();
+        if (buyer_demand <= 0 || stock_and_ask[0] <= 0 || ask <= 0 || buyer.buy_price[flower] < ask)
         {
-            if (strcmp(local_sellers[i].name, global_sellers[seller_idx].name) == 0)
-            {
-                local_seller_idx = i;
-                break;
-            }
-        }
-
-        if (local_seller_idx == -1)
-            return false;
-
-        // Execute trade with thread safety
-        omp_set_lock(&local_buyers[buyer_idx].lock);
-        omp_set_lock(&local_sellers[local_seller_idx].lock);
-
-        int buyer_demand = local_buyers[buyer_idx].demand[flower].load();
-        int seller_stock = local_sellers[local_seller_idx].quantity[flower].load();
-        double buyer_budget = local_buyers[buyer_idx].budget.load();
-
-        if (buyer_demand <= 0 || seller_stock <= 0)
-        {
-            omp_unset_lock(&local_sellers[local_seller_idx].lock);
-            omp_unset_lock(&local_buyers[buyer_idx].lock);
+            buyer.lock.unset();
             return false;
         }
 
-        int affordable = static_cast<int>(buyer_budget / local_sellers[local_seller_idx].price[flower]);
-        int actual_quantity = std::min({affordable, buyer_demand, seller_stock, 3});
+        int affordable = (int)std::min<Cents>(INT_MAX, buyer.budget.load() / ask);
+        int want = std::min({affordable, buyer_demand, 3});
+        bool overdrawn = false;
+        long long start = lock_profiling ? LockProfile::now() : 0;
+        int actual_quantity = want > 0 ? reserveStock(owner, stock_slot, want, &overdrawn) : 0;
+        if (lock_profiling && want > 0)
+            seller_locks[seller_idx].acquired(LockProfile::now() - start, overdrawn);
 
         if (actual_quantity <= 0)
         {
-            omp_unset_lock(&local_sellers[local_seller_idx].lock);
-            omp_unset_lock(&local_buyers[buyer_idx].lock);
+            buyer.lock.unset();
             return false;
         }
 
-        double cost = actual_quantity * local_sellers[local_seller_idx].price[flower];
+        Cents cost = (Cents)actual_quantity * ask;
 
         // Update buyer
-        local_buyers[buyer_idx].demand[flower].fetch_sub(actual_quantity);
-        local_buyers[buyer_idx].budget.fetch_sub(cost);
-        local_buyers[buyer_idx].spent.fetch_add(cost);
-        local_buyers[buyer_idx].purchases_count.fetch_add(1);
+        buyer.demand[flower].fetch_sub(actual_quantity);
+        buyer.budget.fetch_sub(cost);
+        buyer.spent.fetch_add(cost);
+        buyer.purchases_count.fetch_add(1);
 
         // Update seller
-        local_sellers[local_seller_idx].quantity[flower].fetch_sub(actual_quantity);
-        local_sellers[local_seller_idx].revenue.fetch_add(cost);
-        local_sellers[local_seller_idx].trades_count.fetch_add(1);
+        bookFill(owner, seller_base, cost);
+
+        buyer.lock.unset();
 
         // Update global statistics
-        total_trades.fetch_add(1);
-        total_volume.fetch_add(cost);
+        market_stats.add(MarketStats::Trades, 1);
+        market_stats.add(MarketStats::Volume, cost);
+        if (owner != mpi_rank)
+            market_stats.add(MarketStats::RemoteTrades, 1);
 
         // Record trade
         TradeRecord record;
-        strcpy(record.buyer_name, local_buyers[buyer_idx].name);
-        strcpy(record.seller_name, local_sellers[local_seller_idx].name);
+        strcpy(record.buyer_name, buyer.name);
+        strcpy(record.seller_name, quote.name);
         record.flower_type = flower;
         record.quantity = actual_quantity;
-        record.price_per_unit = local_sellers[local_seller_idx].price[flower];
+        record.price_per_unit = ask;
         record.total_cost = cost;
         record.thread_id = omp_get_thread_num();
         record.process_id = mpi_rank;
 
-        trade_history.push_back(record);
-
-        // Print trade info
         {
-            std::lock_guard<std::mutex> lock(print_mutex);
-            std::cout << "[P" << mpi_rank << ":T" << omp_get_thread_num() << "] "
-                      << local_buyers[buyer_idx].name << " bought " << actual_quantity
-                      << " " << FlowerNames[flower] << "(s) from " << local_sellers[local_seller_idx].name
-                      << " for $" << std::fixed << std::setprecision(2) << cost << "\n";
+            // Threads trading with different sellers append concurrently
+            std::lock_guard<ProfiledMutex> lock(trade_mutex);
+            trade_history.push_back(record);
         }
 
-        omp_unset_lock(&local_sellers[local_seller_idx].lock);
-        omp_unset_lock(&local_buyers[buyer_idx].lock);
+        // Print trade info
+        logger.log(LOG_TRADES, FillEvent, buyer_idx, seller_idx, flower, actual_quantity, cost);
 
         return true;
     }
@@ -589,9 +818,9 @@ public:
         {
             for (int flower = 0; flower < 3; ++flower)
             {
-                if (local_sellers[i].price[flower] > 0.3)
+                if (local_sellers[i].price[flower] > PRICE_FLOOR)
                 {
-                    local_sellers[i].price[flower] = std::max(0.3, local_sellers[i].price[flower] - 0.25);
+                    local_sellers[i].price[flower] = std::max(PRICE_FLOOR, local_sellers[i].price[flower] - PRICE_DROP);
                 }
             }
         }
@@ -667,11 +896,30 @@ public:
             std::this_thread::sleep_for(std::chrono::milliseconds(500));
         }
 
+        logger.stop();
         printFinalReport();
     }
 
     void printFinalReport()
     {
+        std::vector<long long> totals = globalStats();
+
+        // Every cent and unit a buyer got must have left a seller, whichever rank each is on
+        long long local_books[4] = {0, 0, 0, 0}, books[4];
+        for (const Buyer &buyer : local_buyers)
+        {
+            local_books[0] += buyer.spent.load();
+            for (int j = 0; j < 3; ++j)
+                local_books[2] += buyer.original_demand[j] - buyer.demand[j].load();
+        }
+        for (const Seller &seller : local_sellers)
+        {
+            local_books[1] += seller.revenue.load();
+            for (int j = 0; j < 3; ++j)
+                local_books[3] += seller.original_quantity[j] - seller.quantity[j].load();
+        }
+        MPI_Reduce(local_books, books, 4, MPI_LONG_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+
         if (mpi_rank == 0)
         {
             std::cout << "\n"
@@ -681,8 +929,12 @@ public:
 
             std::cout << "MPI Processes: " << mpi_size << "\n";
             std::cout << "OpenMP Threads per process: " << omp_get_max_threads() << "\n";
-            std::cout << "Total Trades: " << total_trades.load() << "\n";
-            std::cout << "Total Volume: $" << std::fixed << std::setprecision(2) << total_volume.load() << "\n";
+            std::cout << "Total Trades: " << totals[MarketStats::Trades] << "\n";
+            std::cout << "Total Volume: $" << formatCents(totals[MarketStats::Volume]) << "\n";
+            std::cout << "Cross-Rank Trades: " << totals[MarketStats::RemoteTrades] << "\n";
+            std::cout << "Conservation: spent $" << formatCents(books[0]) << ", revenue $" << formatCents(books[1])
+                      << ", units " << books[2] << "/" << books[3]
+                      << (books[0] == books[1] && books[2] == books[3] ? " (exact)" : " (MISMATCH)") << "\n";
         }
 
         // Each process reports its local statistics
@@ -695,16 +947,18 @@ public:
                 std::cout << "\nProcess " << mpi_rank << " Local Results:\n";
                 std::cout << "Local Sellers: " << local_sellers.size() << "\n";
                 std::cout << "Local Buyers: " << local_buyers.size() << "\n";
-                std::cout << "Local Trades: " << trade_history.size() << "\n";
+                std::cout << "Local Trades: " << market_stats.read(MarketStats::Trades) << "\n";
 
-                double local_revenue = 0.0;
+                Cents local_revenue = 0;
 #pragma omp parallel for reduction(+ : local_revenue)
                 for (int i = 0; i < local_sellers.size(); ++i)
                 {
                     local_revenue += local_sellers[i].revenue.load();
                 }
 
-                std::cout << "Local Revenue: $" << std::fixed << std::setprecision(2) << local_revenue << "\n";
+                std::cout << "Local Revenue: $" << formatCents(local_revenue) << "\n";
+                if (lock_profiling)
+                    printLockContention();
             }
             MPI_Barrier(MPI_COMM_WORLD);
         }
@@ -712,6 +966,13 @@ public:
 
     void finalizeMPI()
     {
+        if (market_win != MPI_WIN_NULL)
+        {
+            MPI_Win_unlock_all(market_win);
+            MPI_Win_free(&market_win);
+        }
+        if (quote_type != MPI_DATATYPE_NULL)
+            MPI_Type_free(&quote_type);
         MPI_Finalize();
     }
 };
@@ -726,9 +987,21 @@ int main(int argc, char **argv)
     // Initialize MPI
     market.initializeMPI(argc, argv);
 
+    // "--log-level quiet|trades" picks how much is logged (default trades)
+    int log_level = LOG_TRADES;
+    for (int i = 1; i + 1 < argc; ++i)
+        if (strcmp(argv[i], "--log-level") == 0)
+            log_level = strcmp(argv[i + 1], "quiet") == 0 ? LOG_QUIET : LOG_TRADES;
+    market.startLogging(log_level);
+
     // Initialize market
     market.initializeMarket();
 
+    // "--profile-locks" reports each rank's lock contention, per lock and per seller
+    for (int i = 1; i < argc; ++i)
+        if (strcmp(argv[i], "--profile-locks") == 0)
+            market.profileLocks();
+
     // Run the hybrid market simulation
     market.runMarket();
 
@@ -3,9 +3,12 @@
 #include <iostream>
 #include <vector>
 #include <cstring>
+#include <string>
 #include <algorithm>
+#include <cmath>
 #include <thread>
 #include <chrono>
+#include <numeric>
 
 enum FlowerType
 {
@@ -19,15 +22,15 @@ struct Seller
 {
     char name[20];
     int quantity[3];
-    double price[3];
+    int price[3]; // Ticks
 };
 
 struct Buyer
 {
     char name[20];
     int demand[3];
-    double budget;
-    double buy_price[3];
+    long long budget; // Cents
+    int buy_price[3]; // Ticks
 };
 
 struct Trade
@@ -36,9 +39,128 @@ struct Trade
     int flower_type;
     int seller_id;
     int quantity;
-    double total_cost;
+    long long total_cost; // Cents
 };
 
+// Prices are integer ticks of one cent and budgets integer cents, so they index
+// the ask book directly and a buyer's spend always adds up to the cent
+const int PRICE_DROP = 20; // Ticks every ask falls after each round
+
+// Format cents (or price ticks) as dollars with two decimals
+std::string formatCents(long long amount)
+{
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%s%lld.%02lld", amount < 0 ? "-" : "", std::llabs(amount) / 100, std::llabs(amount) % 100);
+    return buf;
+}
+
+// Ask book for a single flower type. Every seller with stock is linked into the
+// bucket for its price tick, and a bitmap of non-empty ticks lets bestSeller()
+// return the lowest ask in O(1) instead of scanning all sellers. Sellers within
+// a tick keep insertion order, so ties go to whoever was listed first.
+struct AskBook
+{
+    std::vector<int> head, tail;                // per tick, -1 when empty
+    std::vector<int> next, prev, sellerTick;    // per seller, sellerTick = -1 when unlisted
+    std::vector<unsigned long long> occupied;   // bit t set when tick t has sellers
+    int best = -1;                              // lowest occupied tick, -1 when book is empty
+
+    void init(int numSellers, int maxTick)
+    {
+        head.assign(maxTick + 1, -1);
+        tail.assign(maxTick + 1, -1);
+        next.assign(numSellers, -1);
+        prev.assign(numSellers, -1);
+        sellerTick.assign(numSellers, -1);
+        occupied.assign(maxTick / 64 + 1, 0ULL);
+        best = -1;
+    }
+
+    bool listed(int s) const { return sellerTick[s] >= 0; }
+    bool empty() const { return best < 0; }
+    int bestSeller() const { return best < 0 ? -1 : head[best]; }
+    int bestTick() const { return best; }
+
+    void insert(int s, int t)
+    {
+        t = std::min(t, (int)head.size() - 1);
+        sellerTick[s] = t;
+        next[s] = -1;
+        prev[s] = tail[t];
+        if (tail[t] >= 0)
+            next[tail[t]] = s;
+        else
+            head[t] = s;
+        tail[t] = s;
+        occupied[t / 64] |= 1ULL << (t % 64);
+        if (best < 0 || t < best)
+            best = t;
+    }
+
+    void erase(int s)
+    {
+        int t = sellerTick[s];
+        if (t < 0)
+            return;
+        if (prev[s] >= 0)
+            next[prev[s]] = next[s];
+        else
+            head[t] = next[s];
+        if (next[s] >= 0)
+            prev[next[s]] = prev[s];
+        else
+            tail[t] = prev[s];
+        sellerTick[s] = -1;
+
+        if (head[t] < 0)
+        {
+            occupied[t / 64] &= ~(1ULL << (t % 64));
+            if (t == best)
+                best = nextOccupied(t);
+        }
+    }
+
+    // Move a listed seller to a new price tick (used by the price-drop step)
+    void reprice(int s, int t)
+    {
+        if (!listed(s) || sellerTick[s] == t)
+            return;
+        erase(s);
+        insert(s, t);
+    }
+
+    int nextOccupied(int from) const
+    {
+        for (size_t w = from / 64; w < occupied.size(); ++w)
+        {
+            unsigned long long bits = occupied[w];
+            if (w == (size_t)from / 64)
+                bits &= ~0ULL << (from % 64);
+            if (bits)
+                return (int)(w * 64 + __builtin_ctzll(bits));
+        }
+        return -1;
+    }
+};
+
+// Build one ask book per flower from the sellers that still have stock
+void buildAskBooks(std::vector<AskBook> &books, const std::vector<Seller> &sellers)
+{
+    int maxTick = 0;
+    for (const auto &s : sellers)
+        for (int f = 0; f < 3; ++f)
+            maxTick = std::max(maxTick, s.price[f]);
+
+    books.resize(3);
+    for (int f = 0; f < 3; ++f)
+    {
+        books[f].init((int)sellers.size(), maxTick);
+        for (int s = 0; s < (int)sellers.size(); ++s)
+            if (sellers[s].quantity[f] > 0)
+                books[f].insert(s, sellers[s].price[f]);
+    }
+}
+
 bool demandsLeft(const Buyer &buyer)
 {
     for (int i = 0; i < 3; ++i)
@@ -47,6 +169,45 @@ bool demandsLeft(const Buyer &buyer)
     return false;
 }
 
+// Parallel stream compaction: keeps the ids for which keep(id) holds, in their
+// current order. Each thread counts the survivors of its own chunk, a prefix
+// sum over the counts gives every chunk its output offset, then each thread
+// scatters its survivors there.
+template <typename Keep>
+void compactIds(std::vector<int> &ids, Keep &&keep)
+{
+    const int n = ids.size();
+    std::vector<char> flag(n);
+    std::vector<int> offset(omp_get_max_threads() + 1, 0);
+    std::vector<int> out;
+
+#pragma omp parallel
+    {
+        int t = omp_get_thread_num(), nt = omp_get_num_threads();
+        int lo = (long long)n * t / nt, hi = (long long)n * (t + 1) / nt;
+
+        int count = 0;
+        for (int i = lo; i < hi; ++i)
+            count += flag[i] = keep(ids[i]);
+        offset[t + 1] = count;
+
+#pragma omp barrier
+#pragma omp single
+        {
+            for (int k = 1; k <= nt; ++k)
+                offset[k] += offset[k - 1];
+            out.resize(offset[nt]);
+        }
+
+        int pos = offset[t];
+        for (int i = lo; i < hi; ++i)
+            if (flag[i])
+                out[pos++] = ids[i];
+    }
+
+    ids.swap(out);
+}
+
 int main(int argc, char **argv)
 {
     MPI_Init(&argc, &argv);
@@ -70,15 +231,15 @@ int main(int argc, char **argv)
 
     // Master list of 23 buyers
     std::vector<Buyer> allBuyers = {
-        {"Dan", {10, 5, 2}, 500, {4.0, 4.0, 5.0}}, {"Eve", {5, 5, 0}, 300, {3.5, 3.5, 0.0}}, {"Fay", {15, 10, 5}, 1000, {5.0, 4.5, 5.5}}, {"Ben", {10, 0, 5}, 350, {4.5, 0.0, 5.0}}, {"Lia", {2, 2, 2}, 100, {4.0, 4.0, 4.0}}, {"Joe", {5, 10, 5}, 400, {5.0, 5.0, 5.0}}, {"Sue", {5, 5, 5}, 200, {4.5, 4.5, 4.5}}, {"Amy", {1, 1, 1}, 50, {3.0, 3.0, 3.0}}, {"Tim", {4, 6, 3}, 250, {4.5, 4.5, 5.0}}, {"Sam", {7, 8, 4}, 600, {5.0, 5.0, 5.0}}, {"Jill", {3, 4, 5}, 200, {4.0, 4.5, 5.0}}, {"Zoe", {6, 3, 7}, 300, {4.0, 5.0, 5.5}}, {"Max", {5, 5, 5}, 250, {4.5, 4.5, 4.5}}, {"Ivy", {8, 6, 4}, 550, {5.0, 5.0, 5.0}}, {"Leo", {9, 0, 2}, 350, {4.2, 0.0, 5.0}}, {"Kim", {3, 3, 3}, 180, {4.0, 4.0, 4.0}}, {"Tom", {6, 5, 3}, 400, {4.8, 4.8, 5.0}}, {"Nina", {4, 2, 6}, 280, {4.0, 4.0, 5.0}}, {"Ray", {3, 5, 4}, 300, {4.5, 4.5, 4.5}}, {"Liv", {5, 3, 2}, 250, {4.0, 4.0, 4.5}}, {"Oli", {6, 6, 6}, 450, {5.0, 5.0, 5.0}}, {"Ken", {2, 2, 2}, 100, {3.5, 3.5, 3.5}}, {"Ana", {7, 7, 1}, 370, {4.5, 4.5, 4.5}}};
+        {"Dan", {10, 5, 2}, 50000, {400, 400, 500}}, {"Eve", {5, 5, 0}, 30000, {350, 350, 0}}, {"Fay", {15, 10, 5}, 100000, {500, 450, 550}}, {"Ben", {10, 0, 5}, 35000, {450, 0, 500}}, {"Lia", {2, 2, 2}, 10000, {400, 400, 400}}, {"Joe", {5, 10, 5}, 40000, {500, 500, 500}}, {"Sue", {5, 5, 5}, 20000, {450, 450, 450}}, {"Amy", {1, 1, 1}, 5000, {300, 300, 300}}, {"Tim", {4, 6, 3}, 25000, {450, 450, 500}}, {"Sam", {7, 8, 4}, 60000, {500, 500, 500}}, {"Jill", {3, 4, 5}, 20000, {400, 450, 500}}, {"Zoe", {6, 3, 7}, 30000, {400, 500, 550}}, {"Max", {5, 5, 5}, 25000, {450, 450, 450}}, {"Ivy", {8, 6, 4}, 55000, {500, 500, 500}}, {"Leo", {9, 0, 2}, 35000, {420, 0, 500}}, {"Kim", {3, 3, 3}, 18000, {400, 400, 400}}, {"Tom", {6, 5, 3}, 40000, {480, 480, 500}}, {"Nina", {4, 2, 6}, 28000, {400, 400, 500}}, {"Ray", {3, 5, 4}, 30000, {450, 450, 450}}, {"Liv", {5, 3, 2}, 25000, {400, 400, 450}}, {"Oli", {6, 6, 6}, 45000, {500, 500, 500}}, {"Ken", {2, 2, 2}, 10000, {350, 350, 350}}, {"Ana", {7, 7, 1}, 37000, {450, 450, 450}}};
 
     // Manager initializes sellers
     if (rank == 0)
     {
         sellers = {
-            {"Alice", {100, 100, 100}, {6.0, 5.5, 7.0}},
-            {"Bob", {100, 100, 100}, {5.5, 5.2, 6.5}},
-            {"Charlie", {100, 100, 100}, {6.8, 5.0, 7.5}}};
+            {"Alice", {100, 100, 100}, {600, 550, 700}},
+            {"Bob", {100, 100, 100}, {550, 520, 650}},
+            {"Charlie", {100, 100, 100}, {680, 500, 750}}};
     }
     else
     {
@@ -96,6 +257,14 @@ int main(int argc, char **argv)
         std::cout << "[Rank " << rank << "] Assigned " << myBuyers.size() << " buyers\n";
     }
 
+    // Buyers on this rank with demand left, and the units they still want in
+    // total; finished buyers are compacted out after every round
+    std::vector<int> activeBuyers(myBuyers.size());
+    std::iota(activeBuyers.begin(), activeBuyers.end(), 0);
+    long long outstandingDemand = 0;
+    for (const auto &b : myBuyers)
+        outstandingDemand += b.demand[0] + b.demand[1] + b.demand[2];
+
     bool global_done = false;
     int round = 0;
     const int MAX_ROUNDS = 50; // Prevent infinite loops
@@ -116,43 +285,39 @@ int main(int argc, char **argv)
 
         if (rank != 0)
         {
+            // Sellers are read-only during matching, so the books are built once
+            // per round and shared by all threads
+            std::vector<AskBook> books;
+            buildAskBooks(books, sellers);
+
 // Use OpenMP to parallelize buyer processing
 #pragma omp parallel
             {
                 std::vector<Trade> local_trades;
 
 #pragma omp for
-                for (int b = 0; b < (int)myBuyers.size(); ++b)
+                for (int a = 0; a < (int)activeBuyers.size(); ++a)
                 {
+                    int b = activeBuyers[a];
                     for (int f = 0; f < 3; ++f)
                     {
                         if (myBuyers[b].demand[f] > 0)
                         {
-                            // Find best seller for this flower type
+                            // Best seller for this flower type is the head of its ask book
                             int best_seller = -1;
-                            double best_price = 999999.0;
-
-                            for (int s = 0; s < 3; ++s)
-                            {
-                                if (sellers[s].quantity[f] > 0 &&
-                                    sellers[s].price[f] <= myBuyers[b].buy_price[f] &&
-                                    sellers[s].price[f] < best_price)
-                                {
-                                    best_seller = s;
-                                    best_price = sellers[s].price[f];
-                                }
-                            }
+                            if (!books[f].empty() && books[f].bestTick() <= myBuyers[b].buy_price[f])
+                                best_seller = books[f].bestSeller();
 
                             if (best_seller >= 0)
                             {
-                                int max_affordable = (int)(myBuyers[b].budget / sellers[best_seller].price[f]);
+                                int max_affordable = (int)std::min<long long>(myBuyers[b].demand[f], myBuyers[b].budget / sellers[best_seller].price[f]);
                                 int qty = std::min({sellers[best_seller].quantity[f],
                                                     myBuyers[b].demand[f],
                                                     max_affordable});
 
                                 if (qty > 0)
                                 {
-                                    double cost = qty * sellers[best_seller].price[f];
+                                    long long cost = (long long)qty * sellers[best_seller].price[f];
 
                                     // Create trade record
                                     Trade trade;
@@ -178,13 +343,18 @@ int main(int argc, char **argv)
                 }
             }
 
+            for (const auto &trade : trades)
+                outstandingDemand -= trade.quantity;
+            compactIds(activeBuyers, [&](int b)
+                       { return demandsLeft(myBuyers[b]); });
+
             // Print trades for this rank
             for (const auto &trade : trades)
             {
                 std::cout << "[Rank " << rank << "] " << myBuyers[trade.buyer_id].name
                           << " wants " << trade.quantity << " " << FlowerNames[trade.flower_type]
                           << "(s) from " << sellers[trade.seller_id].name
-                          << " for $" << trade.total_cost << "\n";
+                          << " for $" << formatCents(trade.total_cost) << "\n";
             }
         }
 
@@ -231,8 +401,8 @@ int main(int argc, char **argv)
             {
                 for (int f = 0; f < 3; ++f)
                 {
-                    if (seller.price[f] > 0.2)
-                        seller.price[f] -= 0.2;
+                    if (seller.price[f] > PRICE_DROP)
+                        seller.price[f] -= PRICE_DROP;
                 }
             }
 
@@ -248,18 +418,7 @@ int main(int argc, char **argv)
         }
 
         // Step 5: Check if all buyers are done
-        int local_done = 1;
-        if (rank != 0)
-        {
-            for (const auto &b : myBuyers)
-            {
-                if (demandsLeft(b))
-                {
-                    local_done = 0;
-                    break;
-                }
-            }
-        }
+        int local_done = (rank == 0 || outstandingDemand == 0) ? 1 : 0;
 
         // Synchronize all processes before collective operation
         MPI_Barrier(MPI_COMM_WORLD);
@@ -283,7 +442,7 @@ int main(int argc, char **argv)
         for (const auto &b : myBuyers)
         {
             std::cout << "[Rank " << rank << "] ✅ " << b.name
-                      << " finished with $" << b.budget << " left, demands: "
+                      << " finished with $" << formatCents(b.budget) << " left, demands: "
                       << b.demand[0] << "/" << b.demand[1] << "/" << b.demand[2] << "\n";
         }
         std::cout << "[Rank " << rank << "] ⏱️ Total Time: " << total_time << " seconds\n";
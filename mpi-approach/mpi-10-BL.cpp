@@ -6,6 +6,10 @@
 #include <chrono>
 #include <cstring>
 #include <algorithm>
+#include <cmath>
+#include <climits>
+
+#include "mpi-routing.h"
 
 enum FlowerType
 {
@@ -19,32 +23,225 @@ struct Seller
 {
     char name[20];
     int quantity[3];
-    double price[3];
+    int price[3]; // Ticks
 };
 
 struct Order
 {
     int demand[3];
-    double budget;
-    double buy_price[3];
+    long long budget; // Cents
+    int buy_price[3]; // Ticks
 };
 
 struct TradeResult
 {
     int fulfilled[3];
-    double remaining_budget;
+    long long remaining_budget;
+};
+
+// Prices are integer ticks of one cent and budgets integer cents, so they index
+// the ask book directly and a buyer's spend always adds up to the cent
+const int PRICE_DROP = 20; // Ticks every ask falls after a round without trades
+
+// Format cents (or price ticks) as dollars with two decimals
+std::string formatCents(long long amount)
+{
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%s%lld.%02lld", amount < 0 ? "-" : "", std::llabs(amount) / 100, std::llabs(amount) % 100);
+    return buf;
+}
+
+// Ask book for a single flower type. Every seller with stock is linked into the
+// bucket for its price tick, and a bitmap of non-empty ticks lets bestSeller()
+// return the lowest ask in O(1) instead of scanning all sellers. Sellers within
+// a tick keep insertion order, so ties go to whoever was listed first.
+struct AskBook
+{
+    std::vector<int> head, tail;                // per tick, -1 when empty
+    std::vector<int> next, prev, sellerTick;    // per seller, sellerTick = -1 when unlisted
+    std::vector<unsigned long long> occupied;   // bit t set when tick t has sellers
+    int best = -1;                              // lowest occupied tick, -1 when book is empty
+
+    void init(int numSellers, int maxTick)
+    {
+        head.assign(maxTick + 1, -1);
+        tail.assign(maxTick + 1, -1);
+        next.assign(numSellers, -1);
+        prev.assign(numSellers, -1);
+        sellerTick.assign(numSellers, -1);
+        occupied.assign(maxTick / 64 + 1, 0ULL);
+        best = -1;
+    }
+
+    bool listed(int s) const { return sellerTick[s] >= 0; }
+    bool empty() const { return best < 0; }
+    int bestSeller() const { return best < 0 ? -1 : head[best]; }
+    int bestTick() const { return best; }
+
+    void insert(int s, int t)
+    {
+        t = std::min(t, (int)head.size() - 1);
+        sellerTick[s] = t;
+        next[s] = -1;
+        prev[s] = tail[t];
+        if (tail[t] >= 0)
+            next[tail[t]] = s;
+        else
+            head[t] = s;
+        tail[t] = s;
+        occupied[t / 64] |= 1ULL << (t % 64);
+        if (best < 0 || t < best)
+            best = t;
+    }
+
+    void erase(int s)
+    {
+        int t = sellerTick[s];
+        if (t < 0)
+            return;
+        if (prev[s] >= 0)
+            next[prev[s]] = next[s];
+        else
+            head[t] = next[s];
+        if (next[s] >= 0)
+            prev[next[s]] = prev[s];
+        else
+            tail[t] = prev[s];
+        sellerTick[s] = -1;
+
+        if (head[t] < 0)
+        {
+            occupied[t / 64] &= ~(1ULL << (t % 64));
+            if (t == best)
+                best = nextOccupied(t);
+        }
+    }
+
+    // Move a listed seller to a new price tick (used by the price-drop step)
+    void reprice(int s, int t)
+    {
+        if (!listed(s) || sellerTick[s] == t)
+            return;
+        erase(s);
+        insert(s, t);
+    }
+
+    int nextOccupied(int from) const
+    {
+        for (size_t w = from / 64; w < occupied.size(); ++w)
+        {
+            unsigned long long bits = occupied[w];
+            if (w == (size_t)from / 64)
+                bits &= ~0ULL << (from % 64);
+            if (bits)
+                return (int)(w * 64 + __builtin_ctzll(bits));
+        }
+        return -1;
+    }
 };
 
-// Function to check if all sellers are out of stock
-bool allSellersOut(const std::vector<Seller> &sellers)
+// Build one ask book per flower from the sellers that still have stock
+void buildAskBooks(std::vector<AskBook> &books, const std::vector<Seller> &sellers)
 {
+    int maxTick = 0;
     for (const auto &s : sellers)
-        for (int i = 0; i < 3; ++i)
-            if (s.quantity[i] > 0)
-                return false;
-    return true;
+        for (int f = 0; f < 3; ++f)
+            maxTick = std::max(maxTick, s.price[f]);
+
+    books.resize(3);
+    for (int f = 0; f < 3; ++f)
+    {
+        books[f].init((int)sellers.size(), maxTick);
+        for (int s = 0; s < (int)sellers.size(); ++s)
+            if (sellers[s].quantity[f] > 0)
+                books[f].insert(s, sellers[s].price[f]);
+    }
+}
+
+// A buyer's order for one flower, routed to the rank owning the seller it targets
+struct RoutedOrder
+{
+    int buyer;  // Buyer index (rank - 1)
+    int seller; // Global seller index
+    int flower;
+    int demand;
+    long long allowance; // Cents of the buyer's budget set aside for this flower
+};
+
+// The owning rank's answer to a RoutedOrder, routed back to the buyer
+struct Fill
+{
+    int buyer;
+    int seller;
+    int flower;
+    int bought;
+    int price; // Ticks
+};
+
+// Lowest ask for one flower. Laid out as MPI_2INT so the market-wide best is
+// one MPI_MINLOC reduction, which also breaks tick ties towards the seller
+// listed first, as an ask book does.
+struct BestAsk
+{
+    int tick;   // INT_MAX when no seller has stock
+    int seller; // Global seller index
+};
+
+void marketBestAsks(const std::vector<AskBook> &books, int firstSeller, BestAsk *best)
+{
+    BestAsk mine[3];
+    for (int f = 0; f < 3; ++f)
+        mine[f] = books[f].empty() ? BestAsk{INT_MAX, INT_MAX} : BestAsk{books[f].bestTick(), firstSeller + books[f].bestSeller()};
+    MPI_Allreduce(mine, best, 3, MPI_2INT, MPI_MINLOC, MPI_COMM_WORLD);
 }
 
+// Highest bid per flower among buyers with demand left, capped by what each
+// can spend, or -1; `order` is this rank's buyer, nullptr on a rank without one
+void marketBestBids(const Order *order, long long *bids)
+{
+    long long mine[3] = {-1, -1, -1};
+    for (int f = 0; f < 3; ++f)
+        if (order && order->demand[f] > 0)
+            mine[f] = std::min<long long>(order->buy_price[f], order->budget);
+    MPI_Allreduce(mine, bids, 3, MPI_LONG_LONG, MPI_MAX, MPI_COMM_WORLD);
+}
+
+// Number of no-trade rounds (price drops) until the lowest ask with stock for
+// some flower meets the limit of an active buyer who can afford one unit, or -1
+// if prices bottom out first. Drops are uniform, so the lowest ask of each book
+// is always the first to cross.
+int dropsUntilCrossing(const BestAsk *asks, const long long *bids)
+{
+    int drops = -1;
+    for (int f = 0; f < 3; ++f)
+    {
+        if (asks[f].tick == INT_MAX)
+            continue;
+
+        int ask = asks[f].tick;
+        long long bid = bids[f];
+
+        // Step the same fixed drop every rank applies
+        int steps = 0;
+        while (ask > bid && ask > PRICE_DROP)
+        {
+            ask -= PRICE_DROP;
+            steps++;
+        }
+
+        if (ask <= bid && (drops < 0 || steps < drops))
+            drops = steps;
+    }
+    return drops;
+}
+
+// Log levels, set at run time with --log-level
+enum LogLevel
+{
+    LOG_QUIET = 0, // Round headers and market events only
+    LOG_TRADES = 1 // Plus one line per fill
+};
+
 // Function to print the current status of sellers and buyers
 void printStatus(const std::vector<Seller> &sellers, const std::vector<Order> &buyerStates, const std::vector<std::string> &buyerNames)
 {
@@ -53,7 +250,7 @@ void printStatus(const std::vector<Seller> &sellers, const std::vector<Order> &b
     {
         std::cout << s.name << ": ";
         for (int i = 0; i < 3; ++i)
-            std::cout << FlowerNames[i] << "=" << s.quantity[i] << " ($" << s.price[i] << ") ";
+            std::cout << FlowerNames[i] << "=" << s.quantity[i] << " ($" << formatCents(s.price[i]) << ") ";
         std::cout << "\n";
     }
 
@@ -63,7 +260,7 @@ void printStatus(const std::vector<Seller> &sellers, const std::vector<Order> &b
         std::cout << buyerNames[i] << ": ";
         for (int f = 0; f < 3; ++f)
             std::cout << FlowerNames[f] << "=" << buyerStates[i].demand[f] << " ";
-        std::cout << " | Budget: $" << buyerStates[i].budget << "\n";
+        std::cout << " | Budget: $" << formatCents(buyerStates[i].budget) << "\n";
     }
 }
 
@@ -77,209 +274,221 @@ int main(int argc, char **argv)
 
     const int numBuyers = size - 1;
 
+    // "--log-level quiet|trades" picks how much rank 0 logs (default trades)
+    int logLevel = LOG_TRADES;
+    for (int i = 1; i + 1 < argc; ++i)
+        if (strcmp(argv[i], "--log-level") == 0)
+            logLevel = strcmp(argv[i + 1], "quiet") == 0 ? LOG_QUIET : LOG_TRADES;
+
     if (size < 2)
     {
         if (rank == 0)
-            std::cerr << "At least 2 processes are needed (1 master + 1 buyer).\n";
+            std::cerr << "At least 2 processes are needed (rank 0 + 1 buyer).\n";
         MPI_Finalize();
         return 0;
     }
 
     // Initial buyer demands and budgets (unchanged)
     std::vector<Order> buyerStates = {
-        {{10, 5, 2}, 500, {4.0, 4.0, 5.0}},
-        {{5, 5, 0}, 300, {3.5, 3.5, 0.0}},
-        {{15, 10, 5}, 1000, {5.0, 4.5, 5.5}},
-        {{10, 0, 5}, 350, {4.5, 0.0, 5.0}},
-        {{2, 2, 2}, 100, {4.0, 4.0, 4.0}},
-        {{5, 10, 5}, 400, {5.0, 5.0, 5.0}},
-        {{5, 5, 5}, 200, {4.5, 4.5, 4.5}},
-        {{1, 1, 1}, 50, {3.0, 3.0, 3.0}},
-        {{4, 6, 3}, 250, {4.5, 4.5, 5.0}},
-        {{7, 8, 4}, 600, {5.0, 5.0, 5.0}},
-        {{3, 4, 5}, 200, {4.0, 4.5, 5.0}},
-        {{6, 3, 7}, 300, {4.0, 5.0, 5.5}},
-        {{5, 5, 5}, 250, {4.5, 4.5, 4.5}},
-        {{8, 6, 4}, 550, {5.0, 5.0, 5.0}},
-        {{9, 0, 2}, 350, {4.2, 0.0, 5.0}},
-        {{3, 3, 3}, 180, {4.0, 4.0, 4.0}},
-        {{6, 5, 3}, 400, {4.8, 4.8, 5.0}},
-        {{4, 2, 6}, 280, {4.0, 4.0, 5.0}},
-        {{3, 5, 4}, 300, {4.5, 4.5, 4.5}},
-        {{5, 3, 2}, 250, {4.0, 4.0, 4.5}},
-        {{6, 6, 6}, 450, {5.0, 5.0, 5.0}},
-        {{2, 2, 2}, 100, {3.5, 3.5, 3.5}},
-        {{7, 7, 1}, 370, {4.5, 4.5, 4.5}}};
+        {{10, 5, 2}, 50000, {400, 400, 500}},
+        {{5, 5, 0}, 30000, {350, 350, 0}},
+        {{15, 10, 5}, 100000, {500, 450, 550}},
+        {{10, 0, 5}, 35000, {450, 0, 500}},
+        {{2, 2, 2}, 10000, {400, 400, 400}},
+        {{5, 10, 5}, 40000, {500, 500, 500}},
+        {{5, 5, 5}, 20000, {450, 450, 450}},
+        {{1, 1, 1}, 5000, {300, 300, 300}},
+        {{4, 6, 3}, 25000, {450, 450, 500}},
+        {{7, 8, 4}, 60000, {500, 500, 500}},
+        {{3, 4, 5}, 20000, {400, 450, 500}},
+        {{6, 3, 7}, 30000, {400, 500, 550}},
+        {{5, 5, 5}, 25000, {450, 450, 450}},
+        {{8, 6, 4}, 55000, {500, 500, 500}},
+        {{9, 0, 2}, 35000, {420, 0, 500}},
+        {{3, 3, 3}, 18000, {400, 400, 400}},
+        {{6, 5, 3}, 40000, {480, 480, 500}},
+        {{4, 2, 6}, 28000, {400, 400, 500}},
+        {{3, 5, 4}, 30000, {450, 450, 450}},
+        {{5, 3, 2}, 25000, {400, 400, 450}},
+        {{6, 6, 6}, 45000, {500, 500, 500}},
+        {{2, 2, 2}, 10000, {350, 350, 350}},
+        {{7, 7, 1}, 37000, {450, 450, 450}}};
 
     std::vector<std::string> buyerNames = {
         "Dan", "Eve", "Fay", "Ben", "Lia", "Joe", "Sue", "Amy", "Tim", "Sam",
         "Jill", "Zoe", "Max", "Ivy", "Leo", "Kim", "Tom", "Nina", "Ray", "Liv", "Oli", "Ken", "Ana"};
 
-    double start_time = 0.0, end_time = 0.0;
-
-    if (rank == 0) // Master Process
+    // Adjusted initial seller prices to be more aligned with buyer buy_prices
+    const std::vector<Seller> listedSellers = {
+        {"Alice", {100, 100, 100}, {450, 400, 500}},    // Reduced initial prices
+        {"Bob", {100, 100, 100}, {400, 380, 480}},      // Reduced initial prices
+        {"Charlie", {100, 100, 100}, {500, 350, 520}}}; // Reduced initial prices
+    const int numSellers = listedSellers.size();
+
+    // Every rank owns a block of sellers and matches the orders routed to
+    // them; ranks 1.. also each hold one buyer. Rank 0 reports as before.
+    int firstSeller = blockStart(numSellers, rank, size);
+    std::vector<Seller> sellers(listedSellers.begin() + firstSeller,
+                                listedSellers.begin() + firstSeller + blockCount(numSellers, rank, size));
+    Order myOrder = rank > 0 ? buyerStates[rank - 1] : Order{};
+    const Order *myBuyer = rank > 0 ? &myOrder : nullptr;
+
+    // Per-flower ask books over this rank's sellers, kept in sync with their stock and prices
+    std::vector<AskBook> books;
+    buildAskBooks(books, sellers);
+
+    double start_time = MPI_Wtime(), end_time = 0.0;
+    int round = 0;
+    bool marketOpen = true;
+
+    if (rank == 0)
+        std::cout << "🌼 MPI Trading Market Simulation Started (" << numBuyers << " buyers, sellers on "
+                  << std::min(size, numSellers) << " ranks)\n";
+
+    while (marketOpen)
     {
-        start_time = MPI_Wtime();
-
-        // Adjusted initial seller prices to be more aligned with buyer buy_prices
-        std::vector<Seller> sellers = {
-            {"Alice", {100, 100, 100}, {4.5, 4.0, 5.0}},    // Reduced initial prices
-            {"Bob", {100, 100, 100}, {4.0, 3.8, 4.8}},      // Reduced initial prices
-            {"Charlie", {100, 100, 100}, {5.0, 3.5, 5.2}}}; // Reduced initial prices
-
-        int round = 0;
-        bool marketOpen = true;
-
-        std::cout << "🌼 MPI Trading Market Simulation Started (" << numBuyers << " buyers)\n";
-
-        while (marketOpen)
-        {
-            round++;
+        round++;
+        if (rank == 0)
             std::cout << "\n--- Round " << round << " ---\n";
-            bool any_trade_in_round = false; // Flag to track if any trade occurred in the current round
 
-            // Receive orders from buyers
-            std::vector<Order> currentOrders(numBuyers);
-            for (int b = 1; b <= numBuyers; ++b)
+        // Each buyer sends every flower it still wants to the rank owning that
+        // flower's best ask. Budget is set aside flower by flower at the quoted
+        // ask, the order it used to be spent in, so fills matched on different
+        // ranks at once can never overspend it.
+        BestAsk asks[3];
+        marketBestAsks(books, firstSeller, asks);
+        std::vector<std::vector<RoutedOrder>> orders(size);
+        if (myBuyer)
+        {
+            long long budgetLeft = myOrder.budget;
+            for (int f = 0; f < 3; ++f)
             {
-                // Ensure buyerStates is correctly indexed for MPI_Recv to match the buyer's rank
-                // Buyer ranks are 1 to numBuyers, so buyerStates[b-1] corresponds to buyer rank 'b'
-                MPI_Recv(&currentOrders[b - 1], sizeof(Order), MPI_BYTE, b, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+                if (myOrder.demand[f] <= 0 || asks[f].tick > myOrder.buy_price[f])
+                    continue;
+                long long allowance = std::min(budgetLeft, (long long)myOrder.demand[f] * asks[f].tick);
+                budgetLeft -= allowance;
+                orders[ownerOf(numSellers, asks[f].seller, size)].push_back(
+                    {rank - 1, asks[f].seller, f, myOrder.demand[f], allowance});
             }
+        }
+        std::vector<RoutedOrder> incoming = exchange(orders);
 
-            std::vector<TradeResult> results(numBuyers);
-
-            // Process each buyer's order
-            for (int b_idx = 0; b_idx < numBuyers; ++b_idx) // Use b_idx for vector index
-            {
-                TradeResult &result = results[b_idx];
-                Order &order = currentOrders[b_idx]; // This 'order' is the buyer's current demand/budget
-
-                // Initialize fulfilled quantities for the current buyer for this round
-                for (int f = 0; f < 3; ++f)
-                    result.fulfilled[f] = 0;
-
-                // Try to fulfill demand for each flower type
-                for (int f = 0; f < 3; ++f)
-                {
-                    if (order.demand[f] <= 0)
-                        continue; // No demand for this flower
-
-                    int bestSellerIdx = -1;
-                    double bestPrice = 1e9; // Initialize with a very high price
-
-                    // Find the best seller for the current flower type
-                    for (int s_idx = 0; s_idx < (int)sellers.size(); ++s_idx)
-                    {
-                        if (sellers[s_idx].quantity[f] > 0 &&
-                            sellers[s_idx].price[f] <= order.buy_price[f] && // Seller's price within buyer's budget limit for this flower
-                            sellers[s_idx].price[f] < bestPrice)             // Found a better price
-                        {
-                            bestPrice = sellers[s_idx].price[f];
-                            bestSellerIdx = s_idx;
-                        }
-                    }
-
-                    if (bestSellerIdx != -1) // A suitable seller was found
-                    {
-                        Seller &seller = sellers[bestSellerIdx]; // Get a reference to the best seller
-
-                        // Calculate how many the buyer can afford based on their budget
-                        int maxAffordableByBudget = (seller.price[f] > 0) ? (int)(order.budget / seller.price[f]) : order.demand[f]; // Avoid division by zero
+        // Match the orders for this rank's sellers. They arrive grouped by
+        // sending rank, which is buyer order, the order the master served them in.
+        std::vector<std::vector<Fill>> fills(size);
+        for (const RoutedOrder &order : incoming)
+        {
+            int s = order.seller - firstSeller, f = order.flower;
+            Seller &seller = sellers[s];
+            int bought = (int)std::min<long long>({order.demand, seller.quantity[f], order.allowance / seller.price[f]});
+            if (bought <= 0)
+                continue;
+
+            seller.quantity[f] -= bought; // Decrease seller's quantity
+            if (seller.quantity[f] <= 0)
+                books[f].erase(s); // Sold out, delist
+            fills[order.buyer + 1].push_back({order.buyer, order.seller, f, bought, seller.price[f]});
+        }
 
-                        // Determine the actual quantity to buy
-                        // It's the minimum of: what the buyer needs, what the seller has, what the buyer can afford
-                        int bought = std::min({order.demand[f], seller.quantity[f], maxAffordableByBudget});
+        // Fills go back to their buyers in a second exchange
+        std::vector<Fill> myFills = exchange(fills);
+        for (const Fill &fill : myFills)
+        {
+            myOrder.demand[fill.flower] -= fill.bought;
+            myOrder.budget -= (long long)fill.bought * fill.price;
+        }
 
-                        if (bought > 0)
-                        {
-                            double cost = bought * seller.price[f];
-                            order.budget -= cost;         // Deduct cost from buyer's budget
-                            seller.quantity[f] -= bought; // Decrease seller's quantity
-                            order.demand[f] -= bought;    // Decrease buyer's demand
-                            result.fulfilled[f] = bought; // Record fulfilled quantity
-                            any_trade_in_round = true;    // Mark that a trade occurred
-
-                            std::cout << buyerNames[b_idx] << " bought " << bought << " " << FlowerNames[f]
-                                      << " from " << seller.name << " at $" << seller.price[f] << "\n";
-                        }
-                    }
-                }
+        if (logLevel >= LOG_TRADES)
+        {
+            std::vector<Fill> allFills = gather(myFills, false);
+            std::stable_sort(allFills.begin(), allFills.end(), [](const Fill &a, const Fill &b)
+                             { return a.flower < b.flower; });
+            std::stable_sort(allFills.begin(), allFills.end(), [](const Fill &a, const Fill &b)
+                             { return a.buyer < b.buyer; });
+            for (const Fill &fill : allFills)
+                std::cout << buyerNames[fill.buyer] << " bought " << fill.bought << " " << FlowerNames[fill.flower]
+                          << " from " << listedSellers[fill.seller].name << " at $" << formatCents(fill.price) << "\n";
+        }
 
-                result.remaining_budget = order.budget; // Update remaining budget for the buyer
-                buyerStates[b_idx] = order;             // Update the master's copy of buyer's state
-            }
+        int traded = !myFills.empty(), any_trade_in_round = 0;
+        MPI_Allreduce(&traded, &any_trade_in_round, 1, MPI_INT, MPI_LOR, MPI_COMM_WORLD);
 
-            // Send results back to buyers
-            for (int b = 1; b <= numBuyers; ++b)
-                MPI_Send(&results[b - 1], sizeof(TradeResult), MPI_BYTE, b, 1, MPI_COMM_WORLD);
+        // Every rank sees the same market-wide best ask and bid per flower, so
+        // they all agree on the drops and on when to close
+        long long bids[3];
+        marketBestAsks(books, firstSeller, asks);
+        marketBestBids(myBuyer, bids);
 
-            // If no trades occurred in this round, reduce seller prices (but not below 0.2)
-            if (!any_trade_in_round)
+        // If no trades occurred in this round, reduce seller prices (while above one drop).
+        // Every round before the next bid/ask crossing would be idle too, so
+        // their drops are applied together and those rounds are skipped.
+        if (!any_trade_in_round)
+        {
+            int drops = std::max(1, dropsUntilCrossing(asks, bids));
+            for (int d = 0; d < drops; ++d)
             {
-                for (auto &s : sellers)
+                for (int s_idx = 0; s_idx < (int)sellers.size(); ++s_idx)
                 {
+                    Seller &s = sellers[s_idx];
                     for (int f = 0; f < 3; ++f)
                     {
-                        if (s.price[f] > 0.2) // Ensure price doesn't go below 0.2
+                        if (s.price[f] > PRICE_DROP) // Ensure price stays positive
                         {
-                            s.price[f] -= 0.2; // Fixed drop
-                            // Alternative: s.price[f] *= 0.95; // Percentage drop
+                            s.price[f] -= PRICE_DROP; // Fixed drop
+                            books[f].reprice(s_idx, s.price[f]);
                         }
                     }
                 }
-                std::cout << "⚠️ No trades occurred in this round. Seller prices dropped.\n";
             }
+            round += drops - 1;
+            marketBestAsks(books, firstSeller, asks);
+            if (rank == 0)
+            {
+                std::cout << "⚠️ No trades occurred in this round. Seller prices dropped";
+                if (drops > 1)
+                    std::cout << " (fast-forwarded " << drops - 1 << " idle rounds)";
+                std::cout << ".\n";
+            }
+        }
 
-            // Print the status of sellers and buyers
-            printStatus(sellers, buyerStates, buyerNames);
+        // Print the status of sellers and buyers
+        std::vector<Seller> allSellers = gather(sellers, false);
+        std::vector<Order> allBuyers = gather(myBuyer ? std::vector<Order>{myOrder} : std::vector<Order>(), false);
+        if (rank == 0)
+            printStatus(allSellers, allBuyers, buyerNames);
 
-            // Check market closure conditions
-            bool allBuyersDone = true;
-            for (const auto &b : buyerStates)
-                for (int f = 0; f < 3; ++f)
-                    if (b.demand[f] > 0)
-                        allBuyersDone = false;
+        // Check market closure conditions
+        int active = 0, anyActive = 0;
+        if (myBuyer)
+            for (int f = 0; f < 3; ++f)
+                if (myOrder.demand[f] > 0)
+                    active = 1;
+        MPI_Allreduce(&active, &anyActive, 1, MPI_INT, MPI_LOR, MPI_COMM_WORLD);
+        bool allBuyersDone = !anyActive;
+
+        bool allSellersOut = true; // An empty book everywhere has no stock left
+        for (int f = 0; f < 3; ++f)
+            if (asks[f].tick != INT_MAX)
+                allSellersOut = false;
 
-            marketOpen = !(allBuyersDone || allSellersOut(sellers));
+        // Stalled: no remaining buyer can ever meet any ask, however far prices drop
+        bool stalled = !allBuyersDone && dropsUntilCrossing(asks, bids) < 0;
+        if (stalled && rank == 0)
+            std::cout << "⛔ No future bid/ask crossing is possible. Closing market.\n";
 
-            // Inform buyers whether the market is still open for the next round
-            for (int b = 1; b <= numBuyers; ++b)
-                MPI_Send(&marketOpen, 1, MPI_CXX_BOOL, b, 2, MPI_COMM_WORLD);
+        marketOpen = !(allBuyersDone || allSellersOut || stalled);
 
+        if (rank == 0)
             std::this_thread::sleep_for(std::chrono::milliseconds(100)); // Small delay for readability
-        }
+    }
 
+    if (rank == 0)
+    {
         end_time = MPI_Wtime();
         std::cout << "\nTotal simulation time: " << (end_time - start_time) << " seconds.\n";
         std::cout << "\n✅ Market closed after " << round << " rounds.\n";
     }
-    else // Buyer Processes (rank > 0)
-    {
-        // Each buyer manages their own order state
-        Order myOrder = buyerStates[rank - 1]; // rank-1 because buyerNames and buyerStates are 0-indexed vectors
-
-        bool marketOpen = true;
-
-        while (marketOpen)
-        {
-            // Send current demand and budget to the master
-            MPI_Send(&myOrder, sizeof(Order), MPI_BYTE, 0, 0, MPI_COMM_WORLD);
-
-            // Receive trade results from the master
-            TradeResult result;
-            MPI_Recv(&result, sizeof(TradeResult), MPI_BYTE, 0, 1, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-
-            // Update local buyer state based on trade results
-            for (int f = 0; f < 3; ++f)
-                myOrder.demand[f] -= result.fulfilled[f];
-            myOrder.budget = result.remaining_budget;
-
-            // Receive market status from the master
-            MPI_Recv(&marketOpen, 1, MPI_CXX_BOOL, 0, 2, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-        }
-    }
 
     MPI_Finalize();
     return 0;
-}
\ No newline at end of file
+}
@@ -3,8 +3,14 @@
 #include <cstring>
 #include <vector>
 #include <algorithm>
+#include <string>
+#include <cstdio>
+#include <cstdlib>
+#include <climits>
 #include <unistd.h> // For usleep function
 
+#include "mpi-routing.h"
+
 enum FlowerType
 {
     ROSE = 0,
@@ -15,34 +21,71 @@ const char *FlowerNames[3] = {"Rose", "Sunflower", "Tulip"};
 
 const int NUM_ROUNDS = 3; // Number of trading rounds
 
+// Money is held as integer cents and prices as integer ticks of one cent, so a
+// buyer's spend and the sellers' takings always add up to the cent
+typedef long long Cents;
+
+// Format cents (or price ticks) as dollars with two decimals
+std::string formatCents(Cents amount)
+{
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%s%lld.%02lld", amount < 0 ? "-" : "", std::llabs(amount) / 100, std::llabs(amount) % 100);
+    return buf;
+}
+
+// Cut a price by `percent`, rounded to the nearest tick
+int dropPrice(int price, int percent)
+{
+    return price - (price * percent + 50) / 100;
+}
+
 struct Seller
 {
     char name[20];
     int quantity[3];
-    double price[3];
+    int price[3]; // Ticks
 };
 
 struct Buyer
 {
     char name[20];
     int demand[3];
-    double budget;
-    double maxPrice[3];
+    Cents budget;
+    int maxPrice[3]; // Ticks
 };
 
-struct Order
+struct TradeResult
+{
+    int fulfilled[3];
+    Cents remaining_budget;
+};
+
+// A slice of a buyer's order: one flower from one seller, routed to the rank owning the seller
+struct RoutedOrder
 {
     int buyerRank;
-    char buyerName[20];
-    int demand[3];
-    double budget;
-    double maxPrice[3];
+    int seller; // Global seller index
+    int flower;
+    int quantity;
 };
 
-struct TradeResult
+// The owning rank's answer to a RoutedOrder, routed back to the buyer
+struct Fill
 {
-    int fulfilled[3];
-    double remaining_budget;
+    int buyerRank;
+    int seller;
+    int flower;
+    int bought;
+    Cents cost;
+};
+
+// An unsold flower's price cut, reported to rank 0 for printing
+struct PriceDrop
+{
+    int seller;
+    int flower;
+    int old_price;
+    int new_price;
 };
 
 void printCurrentStatus(const std::vector<Seller> &sellers, int round)
@@ -65,7 +108,7 @@ void printCurrentStatus(const std::vector<Seller> &sellers, int round)
         std::cout << "\n│   Prices: ";
         for (int i = 0; i < 3; ++i)
         {
-            std::cout << "$" << seller.price[i] << " " << FlowerNames[i];
+            std::cout << "$" << formatCents(seller.price[i]) << " " << FlowerNames[i];
             if (i < 2)
                 std::cout << ", ";
         }
@@ -84,156 +127,191 @@ int main(int argc, char **argv)
     if (size < 2)
     {
         if (rank == 0)
-            std::cout << "Run with at least 2 processes (1 master + 1 buyer)\n";
+            std::cout << "Run with at least 2 processes (rank 0 + 1 buyer)\n";
         MPI_Finalize();
         return 0;
     }
 
     // Predefined buyer list
     std::vector<Buyer> allBuyers = {
-        {"Dan", {10, 5, 2}, 500, {4.0, 4.0, 5.0}},
-        {"Eve", {5, 5, 0}, 300, {3.5, 3.5, 0.0}},
-        {"Fay", {15, 10, 5}, 1000, {5.0, 4.5, 5.5}},
-        {"Ben", {10, 0, 5}, 350, {4.5, 0.0, 5.0}},
-        {"Lia", {2, 2, 2}, 100, {4.0, 4.0, 4.0}},
-        {"Joe", {5, 10, 5}, 400, {5.0, 5.0, 5.0}},
-        {"Sue", {5, 5, 5}, 200, {4.5, 4.5, 4.5}},
-        {"Amy", {1, 1, 1}, 50, {3.0, 3.0, 3.0}},
-        {"Tim", {4, 6, 3}, 250, {4.5, 4.5, 5.0}},
-        {"Sam", {7, 8, 4}, 600, {5.0, 5.0, 5.0}},
-        {"Jill", {3, 4, 5}, 200, {4.0, 4.5, 5.0}},
-        {"Zoe", {6, 3, 7}, 300, {4.0, 5.0, 5.5}},
-        {"Max", {5, 5, 5}, 250, {4.5, 4.5, 4.5}},
-        {"Ivy", {8, 6, 4}, 550, {5.0, 5.0, 5.0}},
-        {"Leo", {9, 0, 2}, 350, {4.2, 0.0, 5.0}},
-        {"Kim", {3, 3, 3}, 180, {4.0, 4.0, 4.0}},
-        {"Tom", {6, 5, 3}, 400, {4.8, 4.8, 5.0}},
-        {"Nina", {4, 2, 6}, 280, {4.0, 4.0, 5.0}},
-        {"Ray", {3, 5, 4}, 300, {4.5, 4.5, 4.5}},
-        {"Liv", {5, 3, 2}, 250, {4.0, 4.0, 4.5}},
-        {"Oli", {6, 6, 6}, 450, {5.0, 5.0, 5.0}},
-        {"Ken", {2, 2, 2}, 100, {3.5, 3.5, 3.5}},
-        {"Ana", {7, 7, 1}, 370, {4.5, 4.5, 4.5}}};
+        {"Dan", {10, 5, 2}, 50000, {400, 400, 500}},
+        {"Eve", {5, 5, 0}, 30000, {350, 350, 0}},
+        {"Fay", {15, 10, 5}, 100000, {500, 450, 550}},
+        {"Ben", {10, 0, 5}, 35000, {450, 0, 500}},
+        {"Lia", {2, 2, 2}, 10000, {400, 400, 400}},
+        {"Joe", {5, 10, 5}, 40000, {500, 500, 500}},
+        {"Sue", {5, 5, 5}, 20000, {450, 450, 450}},
+        {"Amy", {1, 1, 1}, 5000, {300, 300, 300}},
+        {"Tim", {4, 6, 3}, 25000, {450, 450, 500}},
+        {"Sam", {7, 8, 4}, 60000, {500, 500, 500}},
+        {"Jill", {3, 4, 5}, 20000, {400, 450, 500}},
+        {"Zoe", {6, 3, 7}, 30000, {400, 500, 550}},
+        {"Max", {5, 5, 5}, 25000, {450, 450, 450}},
+        {"Ivy", {8, 6, 4}, 55000, {500, 500, 500}},
+        {"Leo", {9, 0, 2}, 35000, {420, 0, 500}},
+        {"Kim", {3, 3, 3}, 18000, {400, 400, 400}},
+        {"Tom", {6, 5, 3}, 40000, {480, 480, 500}},
+        {"Nina", {4, 2, 6}, 28000, {400, 400, 500}},
+        {"Ray", {3, 5, 4}, 30000, {450, 450, 450}},
+        {"Liv", {5, 3, 2}, 25000, {400, 400, 450}},
+        {"Oli", {6, 6, 6}, 45000, {500, 500, 500}},
+        {"Ken", {2, 2, 2}, 10000, {350, 350, 350}},
+        {"Ana", {7, 7, 1}, 37000, {450, 450, 450}}};
+
+    // Every rank owns a block of sellers and fills the order slices routed to
+    // them; ranks 1.. also each play one buyer. Rank 0 prints the market as before.
+    const std::vector<Seller> listedSellers = {
+        {"Alice", {30, 10, 20}, {200, 300, 400}},
+        {"Bob", {20, 20, 10}, {250, 280, 350}},
+        {"Charlie", {10, 5, 10}, {180, 250, 420}}};
+    const int numSellers = listedSellers.size();
+    int firstSeller = blockStart(numSellers, rank, size);
+    std::vector<Seller> sellers(listedSellers.begin() + firstSeller,
+                                listedSellers.begin() + firstSeller + blockCount(numSellers, rank, size));
+
+    // Each process gets a buyer from the list (cycling if needed)
+    auto buyerOf = [&](int buyerRank) -> const Buyer &
+    { return allBuyers[(buyerRank - 1) % allBuyers.size()]; };
+
+    double start_time = MPI_Wtime();
 
     if (rank == 0)
     {
-        // ---------------- Master Process ----------------
-        std::vector<Seller> sellers = {
-            {"Alice", {30, 10, 20}, {2.0, 3.0, 4.0}},
-            {"Bob", {20, 20, 10}, {2.5, 2.8, 3.5}},
-            {"Charlie", {10, 5, 10}, {1.8, 2.5, 4.2}}};
-
-        double start_time = MPI_Wtime();
-
         // Print initial status
         std::cout << "\n🌸 FLOWER TRADING SIMULATION STARTING 🌸\n";
         std::cout << "═══════════════════════════════════════════\n";
-        printCurrentStatus(sellers, 0);
+        printCurrentStatus(listedSellers, 0);
+    }
 
-        for (int round = 1; round <= NUM_ROUNDS; ++round)
+    for (int round = 1; round <= NUM_ROUNDS; ++round)
+    {
+        if (rank == 0)
         {
             std::cout << "\n🔁 ROUND " << round << " STARTS 🔁\n";
             std::cout << "═══════════════════════════════════════\n";
+        }
 
-            // Track if each seller sold a particular flower type
-            std::vector<std::vector<bool>> flowerSold(sellers.size(), std::vector<bool>(3, false));
-
-            for (int buyerRank = 1; buyerRank < size; ++buyerRank)
+        // Every buyer sees the round's stock and prices, walks the sellers in
+        // order as the master used to, and sends each seller's share of its
+        // order to the rank that owns that seller
+        std::vector<Seller> quotes = gather(sellers, true);
+        std::vector<std::vector<RoutedOrder>> orders(size);
+        if (rank > 0)
+        {
+            const Buyer &myBuyer = buyerOf(rank);
+            Cents budgetLeft = myBuyer.budget;
+            for (int flower = 0; flower < 3; ++flower)
             {
-                Order order;
-                MPI_Recv(&order, sizeof(Order), MPI_BYTE, buyerRank, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-
-                TradeResult result = {{0, 0, 0}, order.budget};
-
-                std::cout << "\n💰 Processing order from " << order.buyerName << " (Rank " << buyerRank << "):\n";
-                std::cout << "   Demand: ";
-                for (int i = 0; i < 3; ++i)
+                int needed = myBuyer.demand[flower];
+                for (int s = 0; s < numSellers && needed > 0; ++s)
                 {
-                    std::cout << order.demand[i] << " " << FlowerNames[i];
-                    if (i < 2)
-                        std::cout << ", ";
-                }
-                std::cout << " | Budget: $" << order.budget << "\n";
-
-                for (int flower = 0; flower < 3; ++flower)
-                {
-                    int needed = order.demand[flower];
-                    if (needed <= 0)
+                    // Check if buyer is willing to pay seller's price
+                    const Seller &quote = quotes[s];
+                    if (quote.price[flower] > myBuyer.maxPrice[flower])
                         continue;
 
-                    std::cout << "\n   🌺 Looking for " << needed << " " << FlowerNames[flower] << "(s):\n";
-
-                    for (int s = 0; s < sellers.size(); ++s)
+                    int affordable = (int)std::min<Cents>(budgetLeft / quote.price[flower], INT_MAX);
+                    int buying = std::min({needed, quote.quantity[flower], affordable});
+                    if (buying > 0)
                     {
-                        Seller &seller = sellers[s];
-                        if (needed <= 0)
-                            break;
-
-                        // Check if buyer is willing to pay seller's price
-                        if (seller.price[flower] > order.maxPrice[flower])
-                        {
-                            std::cout << "     ❌ " << seller.name << ": Price $" << seller.price[flower]
-                                      << " > Max price $" << order.maxPrice[flower] << "\n";
-                            continue;
-                        }
-
-                        int affordable = static_cast<int>(result.remaining_budget / seller.price[flower]);
-                        int available = seller.quantity[flower];
-                        int buying = std::min({needed, available, affordable});
-
-                        if (buying > 0)
-                        {
-                            double cost = buying * seller.price[flower];
-                            result.fulfilled[flower] += buying;
-                            result.remaining_budget -= cost;
-                            seller.quantity[flower] -= buying;
-                            needed -= buying;
-
-                            flowerSold[s][flower] = true;
-
-                            std::cout << "     ✅ " << seller.name << ": Bought " << buying
-                                      << " for $" << cost << " (Stock now: " << seller.quantity[flower] << ")\n";
-                        }
-                        else if (available == 0)
-                        {
-                            std::cout << "     ❌ " << seller.name << ": Out of stock\n";
-                        }
-                        else if (affordable == 0)
-                        {
-                            std::cout << "     ❌ " << seller.name << ": Insufficient budget\n";
-                        }
+                        orders[ownerOf(numSellers, s, size)].push_back({rank, s, flower, buying});
+                        budgetLeft -= (Cents)buying * quote.price[flower];
+                        needed -= buying;
                     }
                 }
+            }
+        }
+        std::vector<RoutedOrder> incoming = exchange(orders);
+
+        // Fill the slices for this rank's sellers in buyer rank order, the
+        // order the master served buyers in; a buyer whose slice another buyer
+        // emptied first gets the rest next round
+        std::vector<std::vector<bool>> flowerSold(sellers.size(), std::vector<bool>(3, false));
+        std::vector<std::vector<Fill>> fills(size);
+        for (const RoutedOrder &order : incoming)
+        {
+            int s = order.seller - firstSeller;
+            Seller &seller = sellers[s];
+            int buying = std::min(order.quantity, seller.quantity[order.flower]);
+            if (buying <= 0)
+                continue;
+
+            seller.quantity[order.flower] -= buying;
+            flowerSold[s][order.flower] = true;
+            fills[order.buyerRank].push_back({order.buyerRank, order.seller, order.flower, buying,
+                                              (Cents)buying * seller.price[order.flower]});
+        }
+
+        // Fills go back to their buyers in a second exchange
+        std::vector<Fill> myFills = exchange(fills);
 
-                MPI_Send(&result, sizeof(TradeResult), MPI_BYTE, buyerRank, 0, MPI_COMM_WORLD);
+        std::vector<Fill> allFills = gather(myFills, false);
+        if (rank == 0)
+        {
+            for (int i = 0; i < allFills.size(); ++i)
+            {
+                const Fill &fill = allFills[i];
+                if (i == 0 || allFills[i - 1].buyerRank != fill.buyerRank)
+                    std::cout << "\n💰 Filled order from " << buyerOf(fill.buyerRank).name << " (Rank "
+                              << fill.buyerRank << "):\n";
+                std::cout << "     ✅ " << listedSellers[fill.seller].name << ": Bought " << fill.bought << " "
+                          << FlowerNames[fill.flower] << " for $" << formatCents(fill.cost) << "\n";
             }
+        }
 
-            // 🔽 Price Drop: If flower was not sold, reduce price by 10%
-            std::cout << "\n📉 PRICE ADJUSTMENTS:\n";
-            bool anyPriceDropped = false;
-            for (int s = 0; s < sellers.size(); ++s)
+        if (rank > 0)
+        {
+            const Buyer &myBuyer = buyerOf(rank);
+            TradeResult result = {{0, 0, 0}, myBuyer.budget};
+            for (const Fill &fill : myFills)
             {
-                Seller &seller = sellers[s];
-                for (int f = 0; f < 3; ++f)
+                result.fulfilled[fill.flower] += fill.bought;
+                result.remaining_budget -= fill.cost;
+            }
+
+            std::cout << "\n🛒 Buyer " << myBuyer.name << " (Rank " << rank << ") - ROUND " << round << " Result:\n";
+            std::cout << "   Received: ";
+            for (int i = 0; i < 3; ++i)
+            {
+                std::cout << result.fulfilled[i] << " " << FlowerNames[i];
+                if (i < 2)
+                    std::cout << ", ";
+            }
+            std::cout << "\n   Budget remaining: $" << formatCents(result.remaining_budget) << "\n";
+        }
+
+        // 🔽 Price Drop: If flower was not sold, reduce price by 10%
+        std::vector<PriceDrop> drops;
+        for (int s = 0; s < sellers.size(); ++s)
+        {
+            Seller &seller = sellers[s];
+            for (int f = 0; f < 3; ++f)
+            {
+                if (!flowerSold[s][f] && seller.quantity[f] > 0)
                 {
-                    if (!flowerSold[s][f] && seller.quantity[f] > 0)
-                    {
-                        double old_price = seller.price[f];
-                        seller.price[f] *= 0.9; // drop 10%
-                        std::cout << "⚠️ " << seller.name << "'s " << FlowerNames[f]
-                                  << " price: $" << old_price
-                                  << " → $" << seller.price[f] << " (-10%)\n";
-                        anyPriceDropped = true;
-                    }
+                    int old_price = seller.price[f];
+                    seller.price[f] = dropPrice(old_price, 10); // drop 10%
+                    drops.push_back({firstSeller + s, f, old_price, seller.price[f]});
                 }
             }
-            if (!anyPriceDropped)
+        }
+
+        std::vector<PriceDrop> allDrops = gather(drops, false);
+        std::vector<Seller> allSellers = gather(sellers, false);
+        if (rank == 0)
+        {
+            std::cout << "\n📉 PRICE ADJUSTMENTS:\n";
+            for (const PriceDrop &drop : allDrops)
+                std::cout << "⚠️ " << listedSellers[drop.seller].name << "'s " << FlowerNames[drop.flower]
+                          << " price: $" << formatCents(drop.old_price)
+                          << " → $" << formatCents(drop.new_price) << " (-10%)\n";
+            if (allDrops.empty())
             {
                 std::cout << "✅ No price drops needed - all flower types were sold!\n";
             }
 
             // Print current status after each round
-            printCurrentStatus(sellers, round);
+            printCurrentStatus(allSellers, round);
 
             // Add 100ms pause between rounds (except after the last round)
             if (round < NUM_ROUNDS)
@@ -241,59 +319,25 @@ int main(int argc, char **argv)
                 std::cout << "\n⏸️ Pausing 100ms before next round...\n";
                 usleep(100000); // 100ms = 100,000 microseconds
             }
-        }
 
-        std::cout << "\n🎉 SIMULATION COMPLETE! 🎉\n";
-        std::cout << "═══════════════════════════════════════\n";
-        std::cout << "📦 Final Seller Stock:\n";
-        for (auto &s : sellers)
-        {
-            std::cout << s.name << ": ";
-            for (int i = 0; i < 3; ++i)
-                std::cout << s.quantity[i] << " " << FlowerNames[i] << (i < 2 ? ", " : "\n");
-        }
-
-        double end_time = MPI_Wtime();
-        std::cout << "\n🕒 Total Simulation Time: " << (end_time - start_time) << " seconds\n";
-    }
-    else
-    {
-        // ---------------- Buyer Processes ----------------
-        // Each process gets a buyer from the list (cycling if needed)
-        int buyerIndex = (rank - 1) % allBuyers.size();
-        Buyer myBuyer = allBuyers[buyerIndex];
-
-        for (int round = 1; round <= NUM_ROUNDS; ++round)
-        {
-            Order myOrder;
-            myOrder.buyerRank = rank;
-            strcpy(myOrder.buyerName, myBuyer.name);
-
-            // Copy demand, budget, and max prices from the buyer profile
-            for (int i = 0; i < 3; ++i)
+            if (round == NUM_ROUNDS)
             {
-                myOrder.demand[i] = myBuyer.demand[i];
-                myOrder.maxPrice[i] = myBuyer.maxPrice[i];
-            }
-            myOrder.budget = myBuyer.budget;
-
-            MPI_Send(&myOrder, sizeof(Order), MPI_BYTE, 0, 0, MPI_COMM_WORLD);
-
-            TradeResult result;
-            MPI_Recv(&result, sizeof(TradeResult), MPI_BYTE, 0, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+                std::cout << "\n🎉 SIMULATION COMPLETE! 🎉\n";
+                std::cout << "═══════════════════════════════════════\n";
+                std::cout << "📦 Final Seller Stock:\n";
+                for (auto &s : allSellers)
+                {
+                    std::cout << s.name << ": ";
+                    for (int i = 0; i < 3; ++i)
+                        std::cout << s.quantity[i] << " " << FlowerNames[i] << (i < 2 ? ", " : "\n");
+                }
 
-            std::cout << "\n🛒 Buyer " << myBuyer.name << " (Rank " << rank << ") - ROUND " << round << " Result:\n";
-            std::cout << "   Received: ";
-            for (int i = 0; i < 3; ++i)
-            {
-                std::cout << result.fulfilled[i] << " " << FlowerNames[i];
-                if (i < 2)
-                    std::cout << ", ";
+                double end_time = MPI_Wtime();
+                std::cout << "\n🕒 Total Simulation Time: " << (end_time - start_time) << " seconds\n";
             }
-            std::cout << "\n   Budget remaining: $" << result.remaining_budget << "\n";
         }
     }
 
     MPI_Finalize();
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,85 @@
+// Block partitioning and collective routing shared by the distributed MPI
+// markets (mpi-10-BL, mpi-6-BL, mpiGem/mpi-G-1). Items travel as raw bytes,
+// so T must be trivially copyable.
+#pragma once
+
+#include <mpi.h>
+#include <vector>
+#include <algorithm>
+
+// Sellers are split across all ranks in contiguous blocks; rank r owns
+// [blockStart, blockStart + blockCount), so gathering the blocks in rank order
+// lists the sellers in their original order
+inline int blockCount(int total, int rank, int ranks)
+{
+    return total / ranks + (rank < total % ranks ? 1 : 0);
+}
+
+inline int blockStart(int total, int rank, int ranks)
+{
+    return rank * (total / ranks) + std::min(rank, total % ranks);
+}
+
+inline int ownerOf(int total, int item, int ranks)
+{
+    int rank = 0;
+    while (blockStart(total, rank + 1, ranks) <= item)
+        rank++;
+    return rank;
+}
+
+// Deliver outgoing[r] to rank r: one MPI_Alltoall of the sizes, then one
+// MPI_Alltoallv of the items. Returns what every rank sent here, in sending rank order.
+template <typename T>
+std::vector<T> exchange(const std::vector<std::vector<T>> &outgoing)
+{
+    int size = outgoing.size();
+    std::vector<int> sendCounts(size), sendDispls(size), recvCounts(size), recvDispls(size);
+    std::vector<T> sendBuf;
+    for (int r = 0; r < size; ++r)
+    {
+        sendDispls[r] = sendBuf.size() * sizeof(T);
+        sendCounts[r] = outgoing[r].size() * sizeof(T);
+        sendBuf.insert(sendBuf.end(), outgoing[r].begin(), outgoing[r].end());
+    }
+    MPI_Alltoall(sendCounts.data(), 1, MPI_INT, recvCounts.data(), 1, MPI_INT, MPI_COMM_WORLD);
+
+    int received = 0;
+    for (int r = 0; r < size; ++r)
+    {
+        recvDispls[r] = received;
+        received += recvCounts[r];
+    }
+    std::vector<T> incoming(received / sizeof(T));
+    MPI_Alltoallv(sendBuf.data(), sendCounts.data(), sendDispls.data(), MPI_BYTE,
+                  incoming.data(), recvCounts.data(), recvDispls.data(), MPI_BYTE, MPI_COMM_WORLD);
+    return incoming;
+}
+
+// Collect every rank's items in rank order, on rank 0 only or on every rank
+template <typename T>
+std::vector<T> gather(const std::vector<T> &mine, bool everywhere)
+{
+    int rank, size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+    int bytes = mine.size() * sizeof(T);
+    std::vector<int> counts(size), displs(size);
+    if (everywhere)
+        MPI_Allgather(&bytes, 1, MPI_INT, counts.data(), 1, MPI_INT, MPI_COMM_WORLD);
+    else
+        MPI_Gather(&bytes, 1, MPI_INT, counts.data(), 1, MPI_INT, 0, MPI_COMM_WORLD);
+
+    int total = 0;
+    for (int r = 0; r < size; ++r)
+    {
+        displs[r] = total;
+        total += counts[r];
+    }
+    std::vector<T> all(everywhere || rank == 0 ? total / sizeof(T) : 0);
+    if (everywhere)
+        MPI_Allgatherv(mine.data(), bytes, MPI_BYTE, all.data(), counts.data(), displs.data(), MPI_BYTE, MPI_COMM_WORLD);
+    else
+        MPI_Gatherv(mine.data(), bytes, MPI_BYTE, all.data(), counts.data(), displs.data(), MPI_BYTE, 0, MPI_COMM_WORLD);
+    return all;
+}
@@ -3,7 +3,13 @@
 #include <vector>
 #include <algorithm>
 #include <cstring> // For strcpy
-#include <iomanip> // For std::fixed and std::setprecision
+#include <string>
+#include <cstdio>
+#include <cstdlib>
+#include <climits>
+#include <tuple>   // For std::tie
+
+#include "../mpi-routing.h"
 
 // Enum and constants remain the same
 enum FlowerType
@@ -15,13 +21,31 @@ enum FlowerType
 const char *FlowerNames[3] = {"Rose", "Sunflower", "Tulip"};
 const int NUM_ROUNDS = 3;
 
+// Money is held as integer cents and prices as integer ticks of one cent, so
+// every cent a buyer spends shows up at a seller
+typedef long long Cents;
+
+// Format cents (or price ticks) as dollars with two decimals
+std::string formatCents(Cents amount)
+{
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%s%lld.%02lld", amount < 0 ? "-" : "", std::llabs(amount) / 100, std::llabs(amount) % 100);
+    return buf;
+}
+
+// Cut a price by `percent`, rounded to the nearest tick
+int dropPrice(int price, int percent)
+{
+    return price - (price * percent + 50) / 100;
+}
+
 // Structs for Seller, Order, TradeResult remain the same,
 // but ensure they are "MPI-friendly" (no complex data structures like std::string or std::vector inside)
 struct Seller
 {
     char name[20];
     int quantity[3];
-    double price[3];
+    int price[3]; // Ticks
 };
 
 struct Order
@@ -29,19 +53,43 @@ struct Order
     int buyerId;    // Original ID of the logical buyer (1-20)
     int senderRank; // MPI rank of the process that sent this order
     int demand[3];
-    double budget;
+    Cents budget;
 };
 
 struct TradeResult
 {
     int buyerId; // Original ID of the logical buyer (1-20)
     int fulfilled[3];
-    double remaining_budget;
+    Cents remaining_budget;
+};
+
+// A slice of a logical buyer's order: one flower from one seller, routed to the rank owning the seller
+struct RoutedOrder
+{
+    int buyerId;
+    int senderRank; // MPI rank of the worker holding the buyer
+    int seller;     // Global seller index
+    int flower;
+    int quantity;
 };
 
-// MPI Message Tags
-#define ORDER_TAG 100
-#define RESULT_TAG 101
+// The owning rank's answer to a RoutedOrder, routed back to the worker
+struct Fill
+{
+    int buyerId;
+    int seller;
+    int flower;
+    int bought;
+    Cents cost;
+};
+
+struct PriceDrop
+{
+    int seller;
+    int flower;
+    int old_price;
+    int new_price;
+};
 
 int main(int argc, char **argv)
 {
@@ -53,7 +101,7 @@ int main(int argc, char **argv)
     if (size < 2)
     {
         if (rank == 0)
-            std::cout << "Run with at least 2 processes (1 master + 1+ buyers).\n";
+            std::cout << "Run with at least 2 processes (rank 0 + 1+ buyers).\n";
         MPI_Finalize();
         return 0;
     }
@@ -62,7 +110,7 @@ int main(int argc, char **argv)
     // In a real scenario, this might be loaded from a file or a database.
     // For simplicity, we define it once and each process determines its share.
     std::vector<Order> all_logical_buyers = {
-        {1, 0, {5, 3, 2}, 50.0}, {2, 0, {6, 4, 3}, 60.0}, {3, 0, {7, 2, 2}, 75.0}, {4, 0, {4, 5, 3}, 55.0}, {5, 0, {8, 1, 4}, 80.0}, {6, 0, {5, 3, 2}, 65.0}, {7, 0, {6, 4, 3}, 70.0}, {8, 0, {7, 2, 2}, 85.0}, {9, 0, {4, 5, 3}, 60.0}, {10, 0, {8, 1, 4}, 90.0}, {11, 0, {5, 3, 2}, 52.0}, {12, 0, {6, 4, 3}, 62.0}, {13, 0, {7, 2, 2}, 77.0}, {14, 0, {4, 5, 3}, 57.0}, {15, 0, {8, 1, 4}, 82.0}, {16, 0, {5, 3, 2}, 67.0}, {17, 0, {6, 4, 3}, 72.0}, {18, 0, {7, 2, 2}, 87.0}, {19, 0, {4, 5, 3}, 62.0}, {20, 0, {8, 1, 4}, 92.0}};
+        {1, 0, {5, 3, 2}, 5000}, {2, 0, {6, 4, 3}, 6000}, {3, 0, {7, 2, 2}, 7500}, {4, 0, {4, 5, 3}, 5500}, {5, 0, {8, 1, 4}, 8000}, {6, 0, {5, 3, 2}, 6500}, {7, 0, {6, 4, 3}, 7000}, {8, 0, {7, 2, 2}, 8500}, {9, 0, {4, 5, 3}, 6000}, {10, 0, {8, 1, 4}, 9000}, {11, 0, {5, 3, 2}, 5200}, {12, 0, {6, 4, 3}, 6200}, {13, 0, {7, 2, 2}, 7700}, {14, 0, {4, 5, 3}, 5700}, {15, 0, {8, 1, 4}, 8200}, {16, 0, {5, 3, 2}, 6700}, {17, 0, {6, 4, 3}, 7200}, {18, 0, {7, 2, 2}, 8700}, {19, 0, {4, 5, 3}, 6200}, {20, 0, {8, 1, 4}, 9200}};
     const int NUM_LOGICAL_BUYERS = all_logical_buyers.size();
 
     // --- Determine which logical buyers each worker process will handle ---
@@ -98,131 +146,146 @@ int main(int argc, char **argv)
         }
     }
 
+    // --- Sellers are partitioned across all ranks, rank 0 included ---
+    const std::vector<Seller> listed_sellers = {
+        {"Alice", {30, 10, 20}, {200, 300, 400}},
+        {"Bob", {20, 20, 10}, {250, 280, 350}},
+        {"Charlie", {10, 5, 10}, {180, 250, 420}}};
+    const int NUM_SELLERS = listed_sellers.size();
+    int first_seller = blockStart(NUM_SELLERS, rank, size);
+    std::vector<Seller> sellers(listed_sellers.begin() + first_seller,
+                                listed_sellers.begin() + first_seller + blockCount(NUM_SELLERS, rank, size));
+
     // --- Main Simulation Loop ---
     for (int round = 1; round <= NUM_ROUNDS; ++round)
     {
         if (rank == 0)
         {
-            // ---------------- Master Process ----------------
             std::cout << "\n========================================\n";
             std::cout << "🔁 ROUND " << round << " STARTS 🔁\n";
             std::cout << "========================================\n";
+        }
 
-            // Master's seller data (only master holds this)
-            // Initialized once, then modified across rounds
-            static std::vector<Seller> sellers = {// Use static to persist across rounds
-                                                  {"Alice", {30, 10, 20}, {2.0, 3.0, 4.0}},
-                                                  {"Bob", {20, 20, 10}, {2.5, 2.8, 3.5}},
-                                                  {"Charlie", {10, 5, 10}, {1.8, 2.5, 4.2}}};
-
-            // Track if each seller sold a particular flower type in this round
-            std::vector<std::vector<bool>> flowerSold(sellers.size(), std::vector<bool>(3, false));
-
-            // Master receives orders from all worker processes
-            for (int i = 0; i < NUM_LOGICAL_BUYERS; ++i)
+        // Every worker sees the round's stock and prices and splits each of its
+        // buyers' orders across the sellers in order, as the master used to;
+        // each slice goes to the rank owning that seller
+        std::vector<Seller> quotes = gather(sellers, true);
+        std::vector<std::vector<RoutedOrder>> orders(size);
+        for (const auto &buyer : my_assigned_buyers)
+        {
+            Cents budget_left = buyer.budget;
+            for (int flower = 0; flower < 3; ++flower)
             {
-                Order received_order;
-                MPI_Status status;
-                // Receive from any source (MPI_ANY_SOURCE) to allow workers to send orders in any order
-                MPI_Recv(&received_order, sizeof(Order), MPI_BYTE, MPI_ANY_SOURCE, ORDER_TAG, MPI_COMM_WORLD, &status);
-
-                TradeResult result = {{0, 0, 0}, received_order.budget}; // Initialize result for this order
-
-                // --- Trade Processing Logic (same as before) ---
-                for (int flower = 0; flower < 3; ++flower)
+                int needed = buyer.demand[flower]; // Start with full demand for this flower
+                for (int s = 0; s < NUM_SELLERS && needed > 0; ++s)
                 {
-                    int needed = received_order.demand[flower]; // Start with full demand for this flower
-
-                    for (int s = 0; s < sellers.size(); ++s)
+                    const Seller &quote = quotes[s];
+                    int affordable = (quote.price[flower] > 0) ? (int)std::min<Cents>(budget_left / quote.price[flower], INT_MAX) : 0;
+                    int buying = std::min({needed, quote.quantity[flower], affordable});
+                    if (buying > 0)
                     {
-                        Seller &seller = sellers[s];
-                        if (needed <= 0)
-                            break;
-
-                        int affordable = (seller.price[flower] > 0) ? static_cast<int>(result.remaining_budget / seller.price[flower]) : 0;
-                        int available = seller.quantity[flower];
-                        int buying = std::min({needed, available, affordable});
-
-                        if (buying > 0)
-                        {
-                            double cost = buying * seller.price[flower];
-                            result.fulfilled[flower] += buying;
-                            result.remaining_budget -= cost;
-                            seller.quantity[flower] -= buying;
-                            needed -= buying; // Update remaining needed for THIS flower from THIS order
-                            flowerSold[s][flower] = true;
-
-                            std::cout << "Master: Buyer " << received_order.buyerId << " bought " << buying << " "
-                                      << FlowerNames[flower] << "(s) from " << seller.name
-                                      << " for $" << std::fixed << std::setprecision(2) << cost << "\n";
-                        }
+                        orders[ownerOf(NUM_SELLERS, s, size)].push_back({buyer.buyerId, rank, s, flower, buying});
+                        budget_left -= (Cents)buying * quote.price[flower];
+                        needed -= buying;
                     }
                 }
-                // --- End Trade Processing Logic ---
-
-                result.buyerId = received_order.buyerId; // Pass buyer ID back with result
-                MPI_Send(&result, sizeof(TradeResult), MPI_BYTE, status.MPI_SOURCE, RESULT_TAG, MPI_COMM_WORLD);
             }
+        }
+        std::vector<RoutedOrder> incoming = exchange(orders);
 
-            // Master waits for all workers to finish their sends/receives before price adjustment
-            MPI_Barrier(MPI_COMM_WORLD);
+        // Fill the slices for this rank's sellers in buyer order; a buyer whose
+        // slice was emptied by an earlier buyer retries next round
+        std::vector<std::vector<bool>> flowerSold(sellers.size(), std::vector<bool>(3, false));
+        std::vector<std::vector<Fill>> fills(size);
+        for (const RoutedOrder &order : incoming)
+        {
+            int s = order.seller - first_seller;
+            Seller &seller = sellers[s];
+            int buying = std::min(order.quantity, seller.quantity[order.flower]);
+            if (buying <= 0)
+                continue;
 
-            // 🔽 Price Drop Logic: If flower was not sold, reduce price by 20%
-            std::cout << "\n--- Price Adjustments for Round " << round << " ---\n";
-            for (int s = 0; s < sellers.size(); ++s)
-            {
-                Seller &seller = sellers[s];
-                for (int f = 0; f < 3; ++f)
-                {
-                    if (!flowerSold[s][f] && seller.quantity[f] > 0)
-                    {
-                        double old_price = seller.price[f];
-                        seller.price[f] *= 0.8; // drop 20%
-                        std::cout << "  ⚠️ Price Drop: " << seller.name << "'s " << FlowerNames[f]
-                                  << " price dropped from $" << std::fixed << std::setprecision(2) << old_price
-                                  << " to $" << std::fixed << std::setprecision(2) << seller.price[f] << "\n";
-                    }
-                }
-            }
+            seller.quantity[order.flower] -= buying;
+            flowerSold[s][order.flower] = true;
+            fills[order.senderRank].push_back({order.buyerId, order.seller, order.flower, buying,
+                                               (Cents)buying * seller.price[order.flower]});
+        }
+        std::vector<Fill> my_fills = exchange(fills);
+
+        std::vector<Fill> all_fills = gather(my_fills, false);
+        if (rank == 0)
+        {
+            std::sort(all_fills.begin(), all_fills.end(), [](const Fill &a, const Fill &b)
+                      { return std::tie(a.buyerId, a.flower, a.seller) < std::tie(b.buyerId, b.flower, b.seller); });
+            for (const Fill &fill : all_fills)
+                std::cout << "Buyer " << fill.buyerId << " bought " << fill.bought << " "
+                          << FlowerNames[fill.flower] << "(s) from " << listed_sellers[fill.seller].name
+                          << " for $" << formatCents(fill.cost) << "\n";
         }
         else
         {
             // ---------------- Buyer Processes (Workers) ----------------
-            std::cout << "\n🛒 Buyer Process " << rank << " - ROUND " << round << " STARTS 🛒\n";
-
-            // Each worker processes its assigned logical buyers
-            for (const auto &initial_buyer_data : my_assigned_buyers)
+            std::cout << "\n🛒 Buyer Process " << rank << " - ROUND " << round << " 🛒\n";
+            for (const auto &buyer : my_assigned_buyers)
             {
-                Order myOrder = initial_buyer_data; // Copy initial data
-                myOrder.senderRank = rank;          // Important: Identify sender rank
-
-                // Send the order to the master
-                MPI_Send(&myOrder, sizeof(Order), MPI_BYTE, 0, ORDER_TAG, MPI_COMM_WORLD);
-
-                TradeResult result;
-                // Receive the trade result back from the master
-                MPI_Recv(&result, sizeof(TradeResult), MPI_BYTE, 0, RESULT_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+                TradeResult result = {buyer.buyerId, {0, 0, 0}, buyer.budget};
+                for (const Fill &fill : my_fills)
+                {
+                    if (fill.buyerId != buyer.buyerId)
+                        continue;
+                    result.fulfilled[fill.flower] += fill.bought;
+                    result.remaining_budget -= fill.cost;
+                }
 
                 std::cout << "  🛒 Buyer " << result.buyerId << " (Process " << rank << ") - ROUND " << round << " Result:\n";
                 for (int i = 0; i < 3; ++i)
                     std::cout << "    " << result.fulfilled[i] << " " << FlowerNames[i] << "(s)\n";
-                std::cout << "    Budget left: $" << std::fixed << std::setprecision(2) << result.remaining_budget << "\n";
+                std::cout << "    Budget left: $" << formatCents(result.remaining_budget) << "\n";
             }
-            // All workers wait here before the master performs price adjustments
-            MPI_Barrier(MPI_COMM_WORLD);
+        }
+
+        // 🔽 Price Drop Logic: If flower was not sold, reduce price by 20%
+        std::vector<PriceDrop> drops;
+        for (int s = 0; s < sellers.size(); ++s)
+        {
+            Seller &seller = sellers[s];
+            for (int f = 0; f < 3; ++f)
+            {
+                if (!flowerSold[s][f] && seller.quantity[f] > 0)
+                {
+                    int old_price = seller.price[f];
+                    seller.price[f] = dropPrice(old_price, 20); // drop 20%
+                    drops.push_back({first_seller + s, f, old_price, seller.price[f]});
+                }
+            }
+        }
+
+        std::vector<PriceDrop> all_drops = gather(drops, false);
+        if (rank == 0)
+        {
+            std::cout << "\n--- Price Adjustments for Round " << round << " ---\n";
+            for (const PriceDrop &drop : all_drops)
+                std::cout << "  ⚠️ Price Drop: " << listed_sellers[drop.seller].name << "'s " << FlowerNames[drop.flower]
+                          << " price dropped from $" << formatCents(drop.old_price)
+                          << " to $" << formatCents(drop.new_price) << "\n";
         }
     }
 
+    // Sellers are spread across ranks, so gather them for the final report
+    std::vector<Seller> final_sellers = gather(sellers, false);
     if (rank == 0)
     {
-        // Final summary by the master (only if needed, as sellers are static)
-        // If sellers were dynamic, this is where master would gather and report final state.
-        // For this example, sellers are static and their final state is just after price drops in the last round.
         std::cout << "\n========================================\n";
         std::cout << "🕒 Simulation Finished after " << NUM_ROUNDS << " Rounds\n";
         std::cout << "========================================\n";
+        for (const Seller &seller : final_sellers)
+        {
+            std::cout << seller.name << ": ";
+            for (int i = 0; i < 3; ++i)
+                std::cout << seller.quantity[i] << " " << FlowerNames[i] << (i < 2 ? ", " : "\n");
+        }
     }
 
     MPI_Finalize();
     return 0;
-}
\ No newline at end of file
+}